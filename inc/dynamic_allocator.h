@@ -11,34 +11,60 @@
 #define DYN_ALLOC_MAX_SIZE (32<<20) 					//32 MB
 #define DYN_ALLOC_MIN_BLOCK_SIZE (1<<LOG2_MIN_SIZE)		//8 BYTE
 #define DYN_ALLOC_MAX_BLOCK_SIZE (1<<LOG2_MAX_SIZE) 	//2 KB
+#define DYN_ALLOC_NUM_OF_SIZES (15)						//size classes: powers of 2 (8B..2KB) + 1.5x sizes between them (48B..1.5KB)
+#define DYN_ALLOC_FULLNESS_BINS (4)						//partial pages of each size are grouped by fullness into 4 bins (quarters)
 
 //[2] Data Structures
 struct BlockElement
 {
-	LIST_ENTRY(BlockElement) prev_next_info;	/* linked list links */
+	struct BlockElement *next;					/* next freed block of the same page (blocks are only pushed/popped) */
 };
-LIST_HEAD(BlockElement_List, BlockElement);
-struct BlockElement_List freeBlockLists[LOG2_MAX_SIZE - LOG2_MIN_SIZE + 1] ;
 
+//One entry per page of the DA (pageBlockInfoArr[] is also in the bss of every user program),
+//so it's kept to 16 bytes: the counters are packed in one word (a page has at most
+//PAGE_SIZE/DYN_ALLOC_MIN_BLOCK_SIZE = 512 blocks, and block_size <= DYN_ALLOC_MAX_BLOCK_SIZE)
 struct PageInfoElement
 {
-	LIST_ENTRY(PageInfoElement) prev_next_info;	/* linked list links */
-	uint16 block_size;
-	uint16 num_of_free_blocks;
+	LIST_ENTRY(PageInfoElement) prev_next_info;	/* linked list links (freePagesList, partialPagesLists[][] or fullPagesLists[]) */
+	uint32 block_size : 12;
+	uint32 num_of_free_blocks : 10;
+	uint32 num_of_carved_blocks : 10;			/* blocks split so far (the blocks after them are free but not in free_blocks) */
+	struct BlockElement *free_blocks;			/* freed blocks inside this page only */
 };
 LIST_HEAD(PageInfoElement_List, PageInfoElement);
-struct PageInfoElement_List freePagesList ;
+struct PageInfoElement_List freePagesList ;																	//empty pages (of all sizes)
+struct PageInfoElement_List partialPagesLists[DYN_ALLOC_NUM_OF_SIZES][DYN_ALLOC_FULLNESS_BINS] ;	//pages of each size with some free blocks [bin = used quarter of the page]
+struct PageInfoElement_List fullPagesLists[DYN_ALLOC_NUM_OF_SIZES] ;								//pages of each size with no free blocks
 struct PageInfoElement pageBlockInfoArr[DYN_ALLOC_MAX_SIZE/PAGE_SIZE];
 
+//Block size of each size class (defined in lib/dynamic_allocator.c). A page of a class holds
+//PAGE_SIZE/block_size blocks and the remainder at its end (if any) is never used
+extern const uint16 dynAllocBlockSizes[DYN_ALLOC_NUM_OF_SIZES];
+
 //[3] Limits (to be set in initialize_dynamic_allocator())
 uint32 dynAllocStart;
 uint32 dynAllocEnd;
 
+//[4] Statistics (reset in initialize_dynamic_allocator())
+struct DynAllocStats
+{
+	uint32 num_of_allocs[DYN_ALLOC_NUM_OF_SIZES];		//total num of alloc_block() served from each size class
+	uint32 num_of_frees[DYN_ALLOC_NUM_OF_SIZES];		//total num of free_block() of each size class
+	uint32 num_of_used_blocks[DYN_ALLOC_NUM_OF_SIZES];	//blocks currently allocated from each size class
+	uint32 num_of_pages[DYN_ALLOC_NUM_OF_SIZES];		//pages currently held by each size class
+	uint32 wasted_bytes[DYN_ALLOC_NUM_OF_SIZES];		//total (block size - requested size) over all allocations (internal fragmentation)
+	uint32 num_of_pages_in_use;							//pages currently held by all size classes
+	uint32 peak_num_of_pages_in_use;					//max value reached by num_of_pages_in_use
+	uint32 num_of_failed_allocs;						//alloc_block() calls that returned NULL
+};
+struct DynAllocStats dynAllocStats;
+
 /*FUNCTIONS*/
 //=============================================================================
 /*2025*/ //GIVEN FUNCTIONS
 __inline__ uint32 to_page_va(struct PageInfoElement *ptrPageInfo);
 __inline__ struct PageInfoElement * to_page_info(uint32 va);
+__inline__ int get_size_class(uint32 size);		//O(1) index of the size class (in partialPagesLists/fullPagesLists) that fits the given size
 
 //KERNEL: implemented inside kern/mem/kheap.c
 //USER: implemented inside kern/mem/uheap.c
@@ -51,8 +77,17 @@ void initialize_dynamic_allocator(uint32 daStart, uint32 daEnd);
 void *alloc_block(uint32 size);
 void free_block(void* va);
 __inline__ uint32 get_block_size(void *va);
+uint32 alloc_blocks(uint32 size, uint32 n, void* out[]);	//allocate "n" blocks of "size" in one batch (returns # allocated)
+void free_blocks(void* ptrs[], uint32 n);					//free "n" blocks in one batch
 
 /*2025*/ //BONUS FUNCTIONS
 void *realloc_block(void* va, uint32 new_size);
 
+//Statistics
+void get_dynalloc_stats(struct DynAllocStats* stats);						//copy the current statistics into the given struct
+void print_dynalloc_stats(char* title, struct DynAllocStats* stats);		//print the given statistics per size class
+
+//Integrity
+int check_dynalloc_integrity();		//verify the page lists & the free blocks of each used page (returns # errors found)
+
 #endif
@@ -111,6 +111,7 @@ int 	sys_check_WS_list(uint32* WS_list_content, int actual_WS_list_size, uint32
 void 	sys_utilities(char* utilityName, int value);
 //2025
 int 	sys_get_optimal_num_faults();
+void 	sys_get_kheap_da_stats(struct DynAllocStats* stats);
 
 /* concurrency.c */
 void env_sleep(uint32 apprxMilliSeconds);
@@ -34,6 +34,9 @@
  *                     :              .               :
  *                     :              .               :
  *KERNEL_HEAP_START -> +------------------------------+ 0xf6000000
+ *                     |  Zeroing Page CPU0           | RW/--  PAGE_SIZE (see ZEROING_VA)
+ *                     + ...                          +        (NCPUS pages)
+ *                     +------------------------------+
  *                     :              .               :
  *                     :              .               :
  *                     |~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~| RW/--
@@ -224,6 +227,16 @@ struct FrameInfo {
     // Stores the total number of pages in the allocation block this frame belongs to.
     // Essential for kfree() to know how many pages to unmap.
     uint32 num_of_allocated_pages;
+
+    // Buddy allocator (frames of the buddy zone only): set on the 1st frame of each FREE block
+    // of 2^buddy_order frames (in the free list of its order), cleared once it's allocated/merged.
+    unsigned char is_buddy_free;
+    unsigned char buddy_order;
+
+    // Reverse map (who maps this frame): the 1st mapping is kept inline as (mapper_env, mapped_address),
+    // mapper_env = NULL for the kernel page directory. The others (shared frames only) are in other_mappings.
+    struct Env *mapper_env;
+    struct FrameMapping *other_mappings;
     // --- MODIFICATIONS END ---
 };
 
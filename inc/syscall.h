@@ -50,6 +50,7 @@ enum
 	SYS_get_optimal_num_faults,
 	SYS_allocate_user_mem,
 	SYS_free_user_mem,
+	SYS_get_kheap_da_stats,
 	//TODO: [PROJECT'25.IM#4] CPU SCHEDULING - #1 System Calls - Add suitable code here
 	//Your code is here
 
@@ -24,5 +24,8 @@ void free(void* virtual_address);
 void sfree(void* virtual_address);
 void *realloc(void *virtual_address, uint32 new_size);
 
+//2025
+void print_heap_da_stats();		//print the block allocator statistics of this program's heap & of the kernel heap
+
 
 #endif
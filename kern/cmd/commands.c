@@ -16,6 +16,7 @@
 #include "../cpu/sched.h"
 #include "../disk/pagefile_manager.h"
 #include "../mem/kheap.h"
+#include <inc/dynamic_allocator.h>
 #include "../mem/memory_manager.h"
 #include "../tests/tst_handler.h"
 #include "../tests/utilities.h"
@@ -63,6 +64,11 @@ struct Command commands[] =
 		{"khworstfit", "set KERNEL heap placement strategy to WORST FIT", command_set_kheap_plac_WORSTFIT, 0},
 		{"khcustomfit", "set KERNEL heap placement strategy to CUSTOM FIT", command_set_kheap_plac_CUSTOMFIT, 0},
 		{"kheap?", "print current KERNEL heap placement strategy", command_print_kheap_plac, 0},
+		{"kheapstats", "print statistics of the KERNEL heap block allocator", command_print_kheap_da_stats, 0},
+		{"kheapcheck", "verify the integrity of the KERNEL heap (trees, free & allocated ranges, block allocator)", command_kheap_check, 0},
+		{"kheaptraceon", "start tracing the kmalloc/kfree calls of the KERNEL heap", command_kheap_trace_on, 0},
+		{"kheaptraceoff", "stop tracing the kmalloc/kfree calls of the KERNEL heap", command_kheap_trace_off, 0},
+		{"kheaptrace", "print the last traced kmalloc/kfree calls of the KERNEL heap", command_print_kheap_trace, 0},
 		{"nobuff", "disable buffering", command_disable_buffering, 0},
 		{"buff", "enable buffering", command_enable_buffering, 0},
 		{"nomodbuff", "disable modified buffer", command_disable_modified_buffer, 0},
@@ -1124,6 +1130,41 @@ int command_print_kheap_plac(int number_of_arguments, char **arguments)
 
 	return 0;
 }
+int command_print_kheap_da_stats(int number_of_arguments, char **arguments)
+{
+	struct DynAllocStats stats;
+	kheap_get_da_stats(&stats);
+	print_dynalloc_stats("KERNEL heap", &stats);
+	return 0;
+}
+
+int command_kheap_check(int number_of_arguments, char **arguments)
+{
+	int errors = kheap_check();
+	if (errors == 0)
+		cprintf("KERNEL heap is consistent\n");
+	return 0;
+}
+
+int command_kheap_trace_on(int number_of_arguments, char **arguments)
+{
+	set_kheap_trace(1);
+	cprintf("KERNEL heap tracing is now ENABLED\n");
+	return 0;
+}
+
+int command_kheap_trace_off(int number_of_arguments, char **arguments)
+{
+	set_kheap_trace(0);
+	cprintf("KERNEL heap tracing is now DISABLED\n");
+	return 0;
+}
+
+int command_print_kheap_trace(int number_of_arguments, char **arguments)
+{
+	kheap_print_trace();
+	return 0;
+}
 
 /*2017*///END======================================================
 
@@ -133,6 +133,11 @@ int command_set_kheap_plac_NEXTFIT(int number_of_arguments, char **arguments);
 int command_set_kheap_plac_WORSTFIT(int number_of_arguments, char **arguments);
 int command_set_kheap_plac_CUSTOMFIT(int number_of_arguments, char **arguments);
 int command_print_kheap_plac(int number_of_arguments, char **arguments);
+int command_print_kheap_da_stats(int number_of_arguments, char **arguments);
+int command_kheap_check(int number_of_arguments, char **arguments);
+int command_kheap_trace_on(int number_of_arguments, char **arguments);
+int command_kheap_trace_off(int number_of_arguments, char **arguments);
+int command_print_kheap_trace(int number_of_arguments, char **arguments);
 
 //SCHEDULER Commands
 //======================
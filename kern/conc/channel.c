@@ -30,8 +30,23 @@ void sleep(struct Channel *chan, struct kspinlock* lk)
 {
 	//TODO: [PROJECT'25.IM#5] KERNEL PROTECTION: #1 CHANNEL - sleep
 	//Your code is here
-	//Comment the following line
-	panic("sleep() is not implemented yet...!!");
+	struct Env* p = get_cpu_proc();
+	assert(p != NULL);
+
+	//Once the qlock is held, no wakeup can be missed (wakeup_xxx() takes it), so it's safe to release lk.
+	//The process is queued before releasing lk, so callers that check for sleepers under lk always see it
+	acquire_kspinlock(&ProcessQueues.qlock);
+	{
+		p->env_status = ENV_BLOCKED;
+		enqueue(&(chan->queue), p);
+		release_kspinlock(lk);
+
+		sched();
+	}
+	release_kspinlock(&ProcessQueues.qlock);
+
+	//Reacquire the original lock
+	acquire_kspinlock(lk);
 }
 
 //==================================================
@@ -45,8 +60,13 @@ void wakeup_one(struct Channel *chan)
 {
 	//TODO: [PROJECT'25.IM#5] KERNEL PROTECTION: #2 CHANNEL - wakeup_one
 	//Your code is here
-	//Comment the following line
-	panic("wakeup_one() is not implemented yet...!!");
+	acquire_kspinlock(&ProcessQueues.qlock);
+	{
+		struct Env* e = dequeue(&(chan->queue));
+		if (e != NULL)
+			sched_insert_ready(e);
+	}
+	release_kspinlock(&ProcessQueues.qlock);
 }
 
 //====================================================
@@ -61,7 +81,12 @@ void wakeup_all(struct Channel *chan)
 {
 	//TODO: [PROJECT'25.IM#5] KERNEL PROTECTION: #3 CHANNEL - wakeup_all
 	//Your code is here
-	//Comment the following line
-	panic("wakeup_all() is not implemented yet...!!");
+	acquire_kspinlock(&ProcessQueues.qlock);
+	{
+		struct Env* e;
+		while ((e = dequeue(&(chan->queue))) != NULL)
+			sched_insert_ready(e);
+	}
+	release_kspinlock(&ProcessQueues.qlock);
 }
 
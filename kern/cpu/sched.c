@@ -144,6 +144,10 @@ fos_scheduler(void)
 		}
 		release_kspinlock(&ProcessQueues.qlock);  //release lock: to protect ready & blocked Qs in multi-CPU
 		//cprintf("\n[FOS_SCHEDULER] release: lock status after = %d\n", qlock.locked);
+
+		//Nothing to run till a BLOCKED process resumes: use the idle time to pre-zero some free frames
+		if (is_any_blocked)
+			refill_zeroed_frames();
 	} while (is_any_blocked > 0);
 
 	/*2015*///No more envs... curenv doesn't exist any more! return back to command prompt
@@ -186,6 +186,8 @@ void initialize_kernel_VM()
 		// calls are fininshed, and no remaining data to be allocated for the kernel
 		// map all used pages so far for the kernel
 		boot_map_range(ptr_page_directory, KERNEL_BASE, (uint32)ptr_free_mem - KERNEL_BASE, 0, PERM_WRITEABLE) ;
+		// the per-CPU zeroing pages (see refill_zeroed_frames) MUST lie above this remapped range
+		assert(ZEROING_VA(NCPUS - 1) >= ROUNDUP((uint32)ptr_free_mem, PAGE_SIZE));
 	}
 #else
 	{
@@ -31,6 +31,8 @@ struct
 {
 	struct FrameInfo_List free_frame_list;		// Free list of physical frames_info
 	struct FrameInfo_List modified_frame_list;	// Modified frame list for buffering
+	uint32 num_of_free_buffered;				// # frames in free_frame_list that are still buffered (isBuffered)
+	struct FrameInfo_List zeroed_frame_list;	// Free frames that are already zeroed (filled when the CPU is idle)
 	struct kspinlock mfllock;					// Lock to protect the frame info lists
 } MemFrameLists;
 
@@ -28,9 +28,50 @@
 //	The given addresses may be not aligned on 4 KB
 int cut_paste_pages(uint32* page_directory, uint32 source_va, uint32 dest_va, uint32 num_of_pages)
 {
-	//TODO: PRACTICE: fill this function.
-	//Comment the following line
-	panic("cut_paste_pages() is not implemented yet...!!");
+	source_va = ROUNDDOWN(source_va, PAGE_SIZE);
+	dest_va = ROUNDDOWN(dest_va, PAGE_SIZE);
+	uint32 *ptr_page_table;
+
+	//1. Deny if ANY of the destination pages exists
+	for (uint32 i = 0; i < num_of_pages; i++)
+	{
+		if (get_frame_info(page_directory, dest_va + i*PAGE_SIZE, &ptr_page_table) != NULL)
+			return -1;
+	}
+
+	//2. Move the page table entries (frames are NOT copied, references are unchanged)
+	for (uint32 i = 0; i < num_of_pages; i++)
+	{
+		uint32 src = source_va + i*PAGE_SIZE;
+		uint32 dst = dest_va + i*PAGE_SIZE;
+		uint32 *ptr_src_table, *ptr_dst_table;
+
+		get_page_table(page_directory, src, &ptr_src_table);
+		if (ptr_src_table == NULL)
+			continue;
+		uint32 entry = ptr_src_table[PTX(src)];
+
+		if (get_page_table(page_directory, dst, &ptr_dst_table) == TABLE_NOT_EXIST)
+		{
+#if USE_KHEAP
+			ptr_dst_table = create_page_table(page_directory, dst);
+#else
+			__static_cpt(page_directory, dst, &ptr_dst_table);
+#endif
+		}
+		//ALL 12 permission bits are kept as those of the source
+		ptr_dst_table[PTX(dst)] = entry;
+		ptr_src_table[PTX(src)] = 0;
+		tlb_invalidate(page_directory, (void*)src);
+		tlb_invalidate(page_directory, (void*)dst);
+
+		if (EXTRACT_ADDRESS(entry) != 0 || (entry & (PERM_PRESENT|PERM_BUFFERED)) != 0)
+		{
+			struct FrameInfo* ptr_frame_info = to_frame_info(EXTRACT_ADDRESS(entry));
+			move_frame_mapping(ptr_frame_info, page_directory, src, dst);
+		}
+	}
+	return 0;
 }
 
 //===============================
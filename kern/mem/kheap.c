@@ -2,20 +2,38 @@
 #include <inc/memlayout.h>
 #include <inc/dynamic_allocator.h>
 #include <kern/conc/sleeplock.h>
+#include <kern/conc/channel.h>
 #include <kern/proc/user_environment.h>
 #include <kern/mem/memory_manager.h>
+#include <kern/mem/chunk_operations.h>
 #include "../conc/kspinlock.h"
+#include <kern/cpu/cpu.h>
 #include <inc/queue.h>
 #include "kheap_bst.h"
 
-struct PageChunk_List kheap_page_free_list;
-// trees
+// trees (the only record of the free chunks of the page allocator)
 struct PageChunkNode* kheap_free_tree_by_size = NULL;
 struct PageChunkNode* kheap_free_tree_by_addr = NULL;
+// bins of the free runs of 1, 2, 4 & 8 pages (in front of the trees)
+struct PageChunkNode_List kheap_page_bins[KHEAP_NUM_OF_PAGE_BINS];
 
 uint32 kheapPageAllocStart = 0;
 uint32 kheapPageAllocBreak = 0;
 uint32 kheapPlacementStrategy = 0;
+
+//protects the shared lists of the dynamic allocator (freePagesList, partialPagesLists, ...)
+struct kspinlock kheap_da_lock;
+//processes blocked in kmalloc_wait() till a block is freed (count is updated under kheap_da_lock)
+struct Channel kheap_da_chan;
+static uint32 kheap_da_num_of_waiters = 0;
+
+//ring buffer of the last traced kmalloc/kfree calls (see kheap_trace())
+bool kheapTraceEnabled = 0;
+static struct KHeapTraceEntry kheapTrace[KHEAP_TRACE_SIZE];
+static uint32 kheapTraceCount = 0;		//# of calls recorded so far (the next entry is kheapTrace[kheapTraceCount % KHEAP_TRACE_SIZE])
+static struct kspinlock kheap_trace_lock;
+
+static void initialize_da_magazines();
 //==================================================================================//
 //============================== GIVEN FUNCTIONS ===================================//
 //==================================================================================//
@@ -38,9 +56,14 @@ void kheap_init()
 	}
 	//==================================================================================
 	//==================================================================================
-	LIST_INIT(&kheap_page_free_list);
 	kheap_free_tree_by_size = NULL;
 	kheap_free_tree_by_addr = NULL;
+	for (int i = 0; i < KHEAP_NUM_OF_PAGE_BINS; i++)
+		LIST_INIT(&kheap_page_bins[i]);
+	init_kspinlock(&kheap_da_lock, "KHeap DA Lock");
+	initialize_da_magazines();
+	init_channel(&kheap_da_chan, "KHeap DA Channel");
+	init_kspinlock(&kheap_trace_lock, "KHeap Trace Lock");
 }
 
 //==============================================
@@ -65,7 +88,202 @@ void return_page(void* va)
 //============================ HELPER FUNCTIONS ====================================//
 //==================================================================================//
 
-// Helper to set the FrameInfo data so kfree knows the size and kheap_virtual_address works
+//=========================================
+// PER-CPU MAGAZINES IN FRONT OF THE DA:
+//=========================================
+//Each CPU caches a small stack of free blocks per block size, so that most kmalloc/kfree
+//of blocks don't touch the shared DA lists. Refills and flushes are done in batches
+//of KHEAP_DA_MAGAZINE_BATCH blocks under kheap_da_lock.
+//The magazines of a CPU are protected by their own lock (almost always taken by that CPU only),
+//so that they can be drained from any CPU. Lock order: magazines lock, then kheap_da_lock
+struct DAMagazine
+{
+	uint32 count;
+	void* blocks[KHEAP_DA_MAGAZINE_SIZE];
+};
+struct DAMagazines
+{
+	struct kspinlock lock;
+	struct DAMagazine mags[DYN_ALLOC_NUM_OF_SIZES];
+};
+static struct DAMagazines daMagazines[NCPUS];
+
+static void initialize_da_magazines()
+{
+	for (int i = 0; i < NCPUS; i++)
+	{
+		init_kspinlock(&daMagazines[i].lock, "KHeap DA Magazines Lock");
+		for (int idx = 0; idx < DYN_ALLOC_NUM_OF_SIZES; idx++)
+			daMagazines[i].mags[idx].count = 0;
+	}
+}
+
+//MUST be called with interrupts disabled (i.e. after pushcli) to stay on the same CPU
+static struct DAMagazines* my_da_magazines()
+{
+	return &daMagazines[mycpu() - CPUS];
+}
+
+//MUST be called while holding kheap_da_lock, right after returning block(s) to the DA.
+//Waiters may need different sizes, so wake them all and let each one retry
+static void kheap_wakeup_da_waiters()
+{
+	if (kheap_da_num_of_waiters > 0)
+		wakeup_all(&kheap_da_chan);
+}
+
+//Give back the blocks cached in the magazines of ALL CPUs to the shared lists (the DA
+//unmaps the pages that become empty) and wake up the waiters
+static void drain_da_magazines()
+{
+	if (!KHEAP_USE_DA_MAGAZINES)
+		return;
+	for (int i = 0; i < NCPUS; i++)
+	{
+		acquire_kspinlock(&daMagazines[i].lock);
+		acquire_kspinlock(&kheap_da_lock);
+		for (int idx = 0; idx < DYN_ALLOC_NUM_OF_SIZES; idx++)
+		{
+			struct DAMagazine* mag = &daMagazines[i].mags[idx];
+			while (mag->count > 0)
+				free_block(mag->blocks[--mag->count]);
+		}
+		kheap_wakeup_da_waiters();
+		release_kspinlock(&kheap_da_lock);
+		release_kspinlock(&daMagazines[i].lock);
+	}
+}
+
+static void* kheap_alloc_block(uint32 size)
+{
+	void* va = NULL;
+	if (!KHEAP_USE_DA_MAGAZINES)
+	{
+		acquire_kspinlock(&kheap_da_lock);
+		va = alloc_block(size);
+		release_kspinlock(&kheap_da_lock);
+		return va;
+	}
+
+	pushcli();
+	int idx = get_size_class(size);
+	struct DAMagazines* mags = my_da_magazines();
+	struct DAMagazine* mag = &mags->mags[idx];
+	acquire_kspinlock(&mags->lock);
+	if (mag->count == 0)
+	{
+		//refill a batch from the shared lists
+		uint32 blkSize = dynAllocBlockSizes[idx];
+		acquire_kspinlock(&kheap_da_lock);
+		while (mag->count < KHEAP_DA_MAGAZINE_BATCH)
+		{
+			void* blk = alloc_block(blkSize);
+			if (blk == NULL)
+				break;
+			mag->blocks[mag->count++] = blk;
+		}
+		release_kspinlock(&kheap_da_lock);
+	}
+	if (mag->count > 0)
+		va = mag->blocks[--mag->count];
+	release_kspinlock(&mags->lock);
+	popcli();
+	return va;
+}
+
+//Same as kheap_alloc_block() but, if the DA is exhausted, block the calling process
+//on kheap_da_chan till a block is freed instead of returning NULL
+static void* kheap_alloc_block_wait(uint32 size)
+{
+	void* va = kheap_alloc_block(size);
+	if (va != NULL)
+		return va;
+
+	//count this waiter first, so that the next frees skip the magazines (see kheap_free_block()),
+	//then take back the blocks cached before it (a waiter only retries on the shared lists)
+	acquire_kspinlock(&kheap_da_lock);
+	kheap_da_num_of_waiters++;
+	release_kspinlock(&kheap_da_lock);
+	drain_da_magazines();
+
+	acquire_kspinlock(&kheap_da_lock);
+	while ((va = alloc_block(size)) == NULL)
+	{
+		sleep(&kheap_da_chan, &kheap_da_lock);
+	}
+	kheap_da_num_of_waiters--;
+	release_kspinlock(&kheap_da_lock);
+	return va;
+}
+
+static void kheap_free_block(void* va)
+{
+	if (!KHEAP_USE_DA_MAGAZINES)
+	{
+		acquire_kspinlock(&kheap_da_lock);
+		free_block(va);
+		kheap_wakeup_da_waiters();
+		release_kspinlock(&kheap_da_lock);
+		return;
+	}
+
+	pushcli();
+	struct DAMagazines* mags = my_da_magazines();
+	acquire_kspinlock(&mags->lock);
+	//a process is blocked in kmalloc_wait(): give the block to the DA right away (a block kept in the
+	//magazine can't be seen by the waiter). The count is read under the magazines lock: a waiter counts
+	//itself before draining all the magazines, so either it's seen here or it drains this block
+	if (kheap_da_num_of_waiters > 0)
+	{
+		acquire_kspinlock(&kheap_da_lock);
+		free_block(va);
+		kheap_wakeup_da_waiters();
+		release_kspinlock(&kheap_da_lock);
+	}
+	else
+	{
+		//the page of a live block can't be released, so its block size is stable without the DA lock
+		struct DAMagazine* mag = &mags->mags[get_size_class(get_block_size(va))];
+		if (mag->count == KHEAP_DA_MAGAZINE_SIZE)
+		{
+			//flush a batch to the shared lists
+			acquire_kspinlock(&kheap_da_lock);
+			while (mag->count > KHEAP_DA_MAGAZINE_SIZE - KHEAP_DA_MAGAZINE_BATCH)
+				free_block(mag->blocks[--mag->count]);
+			kheap_wakeup_da_waiters();
+			release_kspinlock(&kheap_da_lock);
+		}
+		mag->blocks[mag->count++] = va;
+	}
+	release_kspinlock(&mags->lock);
+	popcli();
+}
+
+//=========================================
+// KMALLOC/KFREE TRACING:
+//=========================================
+//Record a kmalloc/kfree call in the ring buffer. first_arg is the address of the 1st argument
+//of the traced function, from which getcallerpcs() finds the return address into its caller
+static void kheap_trace(uint32 op, uint32 va, uint32 size, void* first_arg)
+{
+	uint32 pcs[10] = {0};
+	getcallerpcs(first_arg, pcs);
+
+	acquire_kspinlock(&kheap_trace_lock);
+	struct KHeapTraceEntry* entry = &kheapTrace[kheapTraceCount % KHEAP_TRACE_SIZE];
+	entry->op = op;
+	entry->va = va;
+	entry->size = size;
+	entry->caller_eip = pcs[0];
+	kheapTraceCount++;
+	release_kspinlock(&kheap_trace_lock);
+}
+//"size" is only evaluated when tracing is enabled
+#define KHEAP_TRACE(op, va, size, first_arg) \
+	do { if (kheapTraceEnabled) kheap_trace((op), (uint32)(va), (size), (void*)&(first_arg)); } while (0)
+
+// Helper to set the FrameInfo data so kfree knows the size
+// (the mapped address of each frame, for kheap_virtual_address, is set when it's mapped by alloc_pages())
 static void set_allocation_size_info(uint32 start_va, uint32 pages_needed)
 {
     uint32* ptr_page_table;
@@ -73,166 +291,211 @@ static void set_allocation_size_info(uint32 start_va, uint32 pages_needed)
     
     if (first_frame_info != NULL) {
         first_frame_info->num_of_allocated_pages = pages_needed;
-        
-        // We also set the mapped address for all frames to support kheap_virtual_address lookup
-        for (uint32 i = 0; i < pages_needed; i++) {
-            struct FrameInfo* fi = get_frame_info(ptr_page_directory, start_va + (i * PAGE_SIZE), &ptr_page_table);
-            if(fi) fi->mapped_address = start_va + (i * PAGE_SIZE);
-        }
     }
     else panic("set_allocation_size_info: first frame is not mapped!");
 }
 
-// Helper to remove a node from the linked list by address (Syncs List with Tree)
-static void find_and_remove_from_list(uint32 start_addr)
-{
-    struct PageChunk *item;
-    LIST_FOREACH(item, &kheap_page_free_list) {
-        if (item->start == start_addr) {
-            LIST_REMOVE(&kheap_page_free_list, item);
-            free_block(item); // Free the metadata block of the list item
-            return;
-        }
-    }
-}
-
 //==================================================================================//
 //============================ REQUIRED FUNCTIONS ==================================//
 //==================================================================================//
 //===================================
 // [1] ALLOCATE SPACE IN KERNEL HEAP:
 //===================================
-// FAST KMALLOC USING BST INSERTIONS AND EXACT AND MAX SELECTIONS
-static void* page_allocator_fast(unsigned int size)
+//NEXT FIT: the search for a free chunk starts from the end of the last page allocation
+static uint32 kheapNextFitCursor = 0;
+
+static void insert_free_chunk(uint32 chunk_start, uint32 chunk_pages);
+static void release_free_run(uint32 start, uint32 num_of_pages);
+
+// Index of the bin of the free runs of exactly "num_of_pages" pages (-1 if not binned)
+static int page_bin_index(uint32 num_of_pages)
 {
-    uint32 pages_needed = ROUNDUP(size, PAGE_SIZE) / PAGE_SIZE;
+	for (int i = 0; i < KHEAP_NUM_OF_PAGE_BINS; i++)
+	{
+		if (num_of_pages == (1 << i))
+			return i;
+	}
+	return -1;
+}
 
-	// 1. Exact fit
-    struct PageChunkNode* found = bst_find_exact_fit(pages_needed);
-	
-	// 2. Worst fit
-    if (found == NULL) 
-	    found = bst_find_worst_fit(pages_needed);
-    
-    if (found != NULL) {
-        void* allocate_from = (void*)found->start;
+// The bins are an exact fit cache, so only used with CUSTOM FIT.
+// (other strategies must see every free run in the trees to place by address/size)
+static inline bool page_bins_enabled()
+{
+	return get_kheap_strategy() == KHP_PLACE_CUSTOMFIT;
+}
+
+static uint32 num_of_binned_runs()
+{
+	uint32 count = 0;
+	for (int i = 0; i < KHEAP_NUM_OF_PAGE_BINS; i++)
+		count += LIST_SIZE(&kheap_page_bins[i]);
+	return count;
+}
+
+// Move all binned runs to the trees, merging them with their free neighbours
+static void drain_page_bins()
+{
+	for (int i = 0; i < KHEAP_NUM_OF_PAGE_BINS; i++)
+	{
+		while (!LIST_EMPTY(&kheap_page_bins[i]))
+		{
+			struct PageChunkNode* node = LIST_FIRST(&kheap_page_bins[i]);
+			LIST_REMOVE(&kheap_page_bins[i], node);
+			uint32 start = node->start;
+			uint32 num_of_pages = node->num_of_pages;
+			kheap_free_block(node);
+			insert_free_chunk(start, num_of_pages);
+		}
+	}
+}
 
-        bst_remove_by_size(found);
-        bst_remove_by_addr(found);        
-        find_and_remove_from_list(found->start);
+// Find a free chunk of at least "pages_needed" pages according to the kheap placement strategy.
+// Each strategy is a single O(log n) query on the size/address trees.
+static struct PageChunkNode* find_free_chunk(uint32 pages_needed)
+{
+	switch (get_kheap_strategy())
+	{
+	case KHP_PLACE_CONTALLOC:
+		return NULL;	//always allocate at the break
+	case KHP_PLACE_FIRSTFIT:
+		return bst_find_first_fit(pages_needed);
+	case KHP_PLACE_BESTFIT:
+		return bst_find_best_fit(pages_needed);
+	case KHP_PLACE_NEXTFIT:
+		return bst_find_first_fit_from(kheapNextFitCursor, pages_needed);	//wraps around in page_allocator_fast()
+	case KHP_PLACE_WORSTFIT:
+		return bst_find_worst_fit(pages_needed);
+	default:
+	{
+		//CUSTOM FIT: exact fit, else worst fit
+		struct PageChunkNode* found = bst_find_exact_fit(pages_needed);
+		if (found == NULL)
+			found = bst_find_worst_fit(pages_needed);
+		return found;
+	}
+	}
+}
 
-        if (found->num_of_pages > pages_needed) {
+// Take "pages_needed" pages from the start of the given free chunk (returns their va, NOT mapped)
+static uint32 take_from_free_chunk(struct PageChunkNode* found, uint32 pages_needed)
+{
+    uint32 allocate_from = found->start;
 
-            found->start += (pages_needed * PAGE_SIZE);
-            found->num_of_pages -= pages_needed;
-    
-            bst_insert_by_size(found);
-            bst_insert_by_addr(found);
-            
-            struct PageChunk* new_list_node = (struct PageChunk*)alloc_block(sizeof(struct PageChunk));
-            new_list_node->start = found->start;
-            new_list_node->num_of_pages = found->num_of_pages;
-            LIST_INSERT_HEAD(&kheap_page_free_list, new_list_node);
-        }
-        else {
-            free_block(found);
-        }
+    bst_remove_by_size(found);
+    bst_remove_by_addr(found);
 
-        for (uint32 i = 0; i < pages_needed; i++) {
-            uint32 va = (uint32)allocate_from + (i * PAGE_SIZE);
-            int ret = alloc_page(ptr_page_directory, va, PERM_WRITEABLE, 1);
-            if (ret == E_NO_MEM) panic("kmalloc_fast: Out of physical memory!");
-        }
-        
-        set_allocation_size_info((uint32)allocate_from, pages_needed);
-        return allocate_from;
+    if (found->num_of_pages > pages_needed) {
+
+        found->start += (pages_needed * PAGE_SIZE);
+        found->num_of_pages -= pages_needed;
+
+        bst_insert_by_size(found);
+        bst_insert_by_addr(found);
     }
-    
-    // 3. Extend the Break
+    else {
+        kheap_free_block(found);
+    }
+    return allocate_from;
+}
+
+// Take "pages_needed" pages by extending the break (returns their va, NOT mapped, or 0 if no room)
+static uint32 take_from_break(uint32 pages_needed)
+{
     if (kheapPageAllocBreak + (pages_needed * PAGE_SIZE) <= KERNEL_HEAP_MAX) {
-        void* ptr = (void*) kheapPageAllocBreak;
-        for (uint32 i = 0; i < pages_needed; i++) {
-            uint32 va = kheapPageAllocBreak + (i * PAGE_SIZE);
-            int ret = alloc_page(ptr_page_directory, va, PERM_WRITEABLE, 1);
-            if (ret == E_NO_MEM) {
-                for (uint32 j = 0; j < i; j++) {
-                    unmap_frame(ptr_page_directory, kheapPageAllocBreak + (j * PAGE_SIZE));
-                }
-                return NULL; 
-            }
-        }
-        set_allocation_size_info((uint32)kheapPageAllocBreak, pages_needed);
+        uint32 allocate_from = kheapPageAllocBreak;
         kheapPageAllocBreak += (pages_needed * PAGE_SIZE);
-        return ptr;
+        return allocate_from;
     }
-    
-    return NULL;
+    return 0;
 }
 
-static void* page_allocator(unsigned int size)
+// Map "num_of_pages" zeroed pages starting at start in one go (nothing is mapped if out of memory)
+static int map_kheap_pages(uint32 start, uint32 num_of_pages)
 {
-    uint32 pages_needed = ROUNDUP(size, PAGE_SIZE) / PAGE_SIZE;
-    struct PageChunk *cur = NULL;
-    struct PageChunk *found = NULL;
-  	// 1 EXACT fit 
-    LIST_FOREACH(cur, &kheap_page_free_list) {
-        if (cur->num_of_pages == pages_needed) {
-            found = cur;
-            break; 
+    return alloc_pages(ptr_page_directory, start, num_of_pages, PERM_WRITEABLE, 1);
+}
+
+// Reserve a free range of "pages_needed" pages in the page allocator (NOT mapped).
+// Returns its va, or 0 if there's no room
+static uint32 reserve_page_run(uint32 pages_needed)
+{
+    uint32 va = 0;
+
+    // 0. Bin of this exact size (O(1) pop)
+    if (page_bins_enabled()) {
+        int bin = page_bin_index(pages_needed);
+        if (bin >= 0 && !LIST_EMPTY(&kheap_page_bins[bin])) {
+            struct PageChunkNode* run = LIST_FIRST(&kheap_page_bins[bin]);
+            LIST_REMOVE(&kheap_page_bins[bin], run);
+            va = run->start;
+            kheap_free_block(run);
+            return va;
         }
     }
-    // 2 WORST fit 
-    if (found == NULL) {
-		cur = NULL;
-        LIST_FOREACH(cur, &kheap_page_free_list) {
-            if (cur->num_of_pages > pages_needed) { 
-                if (found == NULL || cur->num_of_pages > found->num_of_pages) {
-                    found = cur;
-                }
-            }
-        }
+    else if (num_of_binned_runs() > 0) {
+        drain_page_bins();
     }
-    if (found != NULL) {
-        void* allocate_from = (void*)found->start;
-        if (found->num_of_pages > pages_needed) { 
-            found->start += (pages_needed * PAGE_SIZE);
-            found->num_of_pages -= pages_needed;
-        }
-        else {
-            LIST_REMOVE(&kheap_page_free_list, found);
-            free_block(found); 
-        }
 
-        for (uint32 i = 0; i < pages_needed; i++) {
-            uint32 va = (uint32)allocate_from + (i * PAGE_SIZE);
-            int ret = alloc_page(ptr_page_directory, va, PERM_WRITEABLE, 1);
-            if (ret == E_NO_MEM) 
-                panic("kmalloc_page_allocator: Out of physical memory while mapping a free chunk!");
-        }
-        
-        // set_allocation_size_info((uint32)allocate_from, pages_needed); 
-        return allocate_from;
+    // 1. Free chunk selected by the strategy
+    struct PageChunkNode* found = find_free_chunk(pages_needed);
+    if (found != NULL)
+        va = take_from_free_chunk(found, pages_needed);
+
+    // 2. Extend the Break
+    if (va == 0)
+        va = take_from_break(pages_needed);
+
+    // 3. NEXT FIT: wrap around to the free chunks before the cursor
+    if (va == 0 && get_kheap_strategy() == KHP_PLACE_NEXTFIT) {
+        found = bst_find_first_fit(pages_needed);
+        if (found != NULL)
+            va = take_from_free_chunk(found, pages_needed);
     }
 
-    if (kheapPageAllocBreak + (pages_needed * PAGE_SIZE) <= KERNEL_HEAP_MAX) {
-        void* ptr = (void*) kheapPageAllocBreak;
-        for (uint32 i = 0; i < pages_needed; i++) {
-            uint32 va = kheapPageAllocBreak + (i * PAGE_SIZE);
-            int ret = alloc_page(ptr_page_directory, va, PERM_WRITEABLE, 1);
-            
-            if (ret == E_NO_MEM) {
-                for (uint32 j = 0; j < i; j++) {
-                    unmap_frame(ptr_page_directory, kheapPageAllocBreak + (j * PAGE_SIZE));
-                }
-                return NULL; // Out of memory
-            }
-        }
-        // set_allocation_size_info((uint32)kheapPageAllocBreak, pages_needed); 
-        kheapPageAllocBreak += (pages_needed * PAGE_SIZE); 
-        return ptr;
+    // 4. The binned runs may merge into a large enough chunk
+    if (va == 0 && num_of_binned_runs() > 0) {
+        drain_page_bins();
+        return reserve_page_run(pages_needed);
     }
 
-    return NULL;
+    if (va != 0)
+        kheapNextFitCursor = va + (pages_needed * PAGE_SIZE);
+    return va;
+}
+
+// Set/clear the kmalloc_lazy() mark in the PTEs of the given range
+static void set_lazy_marks(uint32 start, uint32 num_of_pages, bool mark)
+{
+    uint32* ptr_page_table = NULL;
+    for (uint32 i = 0; i < num_of_pages; i++) {
+        uint32 va = start + (i * PAGE_SIZE);
+        if (i == 0 || PTX(va) == 0)
+            get_page_table(ptr_page_directory, va, &ptr_page_table);
+        if (ptr_page_table == NULL)
+            panic("set_lazy_marks: no page table for kernel heap va %x", va);
+        if (mark)
+            ptr_page_table[PTX(va)] |= PERM_KHLAZY;
+        else
+            ptr_page_table[PTX(va)] &= ~PERM_KHLAZY;
+    }
+}
+
+// FAST KMALLOC USING BST QUERIES FOR EACH PLACEMENT STRATEGY
+static void* page_allocator_fast(unsigned int size)
+{
+    uint32 pages_needed = ROUNDUP(size, PAGE_SIZE) / PAGE_SIZE;
+
+    uint32 va = reserve_page_run(pages_needed);
+    if (va == 0)
+        return NULL;
+
+    if (map_kheap_pages(va, pages_needed) != 0) {
+        release_free_run(va, pages_needed);
+        return NULL;
+    }
+    set_allocation_size_info(va, pages_needed);
+    return (void*)va;
 }
 
 void* kmalloc(unsigned int size)
@@ -243,15 +506,101 @@ void* kmalloc(unsigned int size)
 	if(size == 0 ) 
 		return 0;
 	
+	void* va;
 	if(size <= DYN_ALLOC_MAX_BLOCK_SIZE)  // block allocator
-        return alloc_block(size);
+        va = kheap_alloc_block(size);
 	else {
-		// return page_allocator(size);
-		return page_allocator_fast(size);
+		va = page_allocator_fast(size);
 	}
+	KHEAP_TRACE(KHEAP_TRACE_ALLOC, va, size, size);
+	return va;
 	//TODO: [PROJECT'25.BONUS#3] FAST PAGE ALLOCATOR
 }
 
+//Same as kmalloc() but, for page sizes, only reserves the range: each page is mapped (zeroed)
+//by kheap_lazy_fault() on its first touch, so a big buffer only uses frames for the pages it touches.
+//The 1st page is mapped right away as it keeps the size of the allocation (for kfree/krealloc).
+//MUST NOT be touched while holding the frame lists lock (the fault allocates a frame)
+static void* lazy_page_allocator(unsigned int size)
+{
+	uint32 pages_needed = ROUNDUP(size, PAGE_SIZE) / PAGE_SIZE;
+	uint32 va = reserve_page_run(pages_needed);
+	if (va == 0)
+		return NULL;
+	if (map_kheap_pages(va, 1) != 0) {
+		release_free_run(va, pages_needed);
+		return NULL;
+	}
+	set_lazy_marks(va, pages_needed, 1);
+	set_allocation_size_info(va, pages_needed);
+	return (void*)va;
+}
+
+void* kmalloc_lazy(unsigned int size)
+{
+	if (size == 0)
+		return 0;
+
+	void* va;
+	if (size <= DYN_ALLOC_MAX_BLOCK_SIZE)
+		va = kheap_alloc_block(size);
+	else
+		va = lazy_page_allocator(size);
+	KHEAP_TRACE(KHEAP_TRACE_ALLOC, va, size, size);
+	return va;
+}
+
+int kheap_lazy_fault(uint32 fault_va)
+{
+	if (fault_va < kheapPageAllocStart || fault_va >= kheapPageAllocBreak)
+		return 0;
+	uint32* ptr_page_table = NULL;
+	get_page_table(ptr_page_directory, fault_va, &ptr_page_table);
+	if (ptr_page_table == NULL)
+		return 0;
+	uint32 pte = ptr_page_table[PTX(fault_va)];
+	if ((pte & PERM_KHLAZY) == 0 || (pte & PERM_PRESENT) != 0)
+		return 0;
+	if (map_kheap_pages(ROUNDDOWN(fault_va, PAGE_SIZE), 1) != 0)
+		panic("kheap_lazy_fault: out of memory for the lazy page at %x", fault_va);
+	return 1;
+}
+
+//Same as kmalloc() but, for block sizes, the calling process is blocked till a block
+//is freed if the dynamic allocator is exhausted (i.e. never returns NULL for them).
+//MUST be called from a process context that can sleep (i.e. holding no spinlock)
+void* kmalloc_wait(unsigned int size)
+{
+	if(size == 0 )
+		return 0;
+
+	void* va;
+	if(size <= DYN_ALLOC_MAX_BLOCK_SIZE)  // block allocator
+		va = kheap_alloc_block_wait(size);
+	else
+		va = page_allocator_fast(size);
+	KHEAP_TRACE(KHEAP_TRACE_ALLOC, va, size, size);
+	return va;
+}
+
+//Allocate "n" objects of the same (block) size in one batch into out[]: the DA lock, the size class
+//lookup and the page list updates are taken once per batch instead of once per object.
+//Returns the number of allocated objects (less than "n" only if the block allocator is exhausted)
+uint32 kmalloc_blocks(unsigned int size, uint32 n, void* out[])
+{
+	assert(size <= DYN_ALLOC_MAX_BLOCK_SIZE);
+	acquire_kspinlock(&kheap_da_lock);
+	uint32 cnt = alloc_blocks(size, n, out);
+	release_kspinlock(&kheap_da_lock);
+	//traced as "cnt" kmalloc() calls, so each object can be matched with its own kfree()
+	if (kheapTraceEnabled)
+	{
+		for (uint32 i = 0; i < cnt; i++)
+			KHEAP_TRACE(KHEAP_TRACE_ALLOC, out[i], size, size);
+	}
+	return cnt;
+}
+
 //=================================
 // [2] FREE SPACE FROM KERNEL HEAP:
 //=================================
@@ -267,15 +616,54 @@ void page_free(void* virtual_address)
     uint32 pages_to_free = first_frame_info->num_of_allocated_pages;
     if (pages_to_free == 0)
          return; 
+    bool lazy = (ptr_page_table[PTX(va)] & PERM_KHLAZY) != 0;
     
     for (uint32 i = 0; i < pages_to_free; i++) 
         unmap_frame(ptr_page_directory, va + (i * PAGE_SIZE));
     
     first_frame_info->num_of_allocated_pages = 0; 
+    if (lazy)
+        set_lazy_marks(va, pages_to_free, 0);
 
-    uint32 chunk_start = va;
-    uint32 chunk_pages = pages_to_free;
-    
+    // Small run: park it in its bin without merging (unless it's at the break, which shrinks as usual)
+    int bin = page_bin_index(pages_to_free);
+    if (page_bins_enabled() && bin >= 0 && LIST_SIZE(&kheap_page_bins[bin]) < KHEAP_PAGE_BIN_MAX_RUNS
+        && va + (pages_to_free * PAGE_SIZE) != kheapPageAllocBreak) {
+        struct PageChunkNode* run = (struct PageChunkNode*)kheap_alloc_block(sizeof(struct PageChunkNode));
+        if (run == NULL) panic("page_free: out of memory for PageChunkNode struct!");
+        run->start = va;
+        run->num_of_pages = pages_to_free;
+        LIST_INSERT_HEAD(&kheap_page_bins[bin], run);
+        return;
+    }
+
+    release_free_run(va, pages_to_free);
+}
+
+// Size in bytes of the allocation at va (0 if it's not an allocated block/page range)
+static uint32 kheap_allocation_size(uint32 va)
+{
+    if (va >= KERNEL_HEAP_START && va < dynAllocEnd)
+        return get_block_size((void*)va);
+    uint32* ptr_page_table = NULL;
+    struct FrameInfo* first_frame_info = get_frame_info(ptr_page_directory, va, &ptr_page_table);
+    return (first_frame_info == NULL) ? 0 : first_frame_info->num_of_allocated_pages * PAGE_SIZE;
+}
+
+// Give back an unmapped run to the trees (or to the break)
+static void release_free_run(uint32 start, uint32 num_of_pages)
+{
+    uint32 old_break = kheapPageAllocBreak;
+    insert_free_chunk(start, num_of_pages);
+
+    // The break went down: binned runs may now be merged into it
+    if (kheapPageAllocBreak != old_break && num_of_binned_runs() > 0)
+        drain_page_bins();
+}
+
+// Add a free chunk to the trees, merging it with its free neighbours (or with the break)
+static void insert_free_chunk(uint32 chunk_start, uint32 chunk_pages)
+{
     struct PageChunkNode* prev_node = bst_find_prev_neighbor(chunk_start);
     struct PageChunkNode* next_node = bst_find_next_neighbor(chunk_start);
     
@@ -286,33 +674,28 @@ void page_free(void* virtual_address)
 
     if (merge_prev && merge_next) { // Merge BOTH
         bst_remove_by_size(prev_node); bst_remove_by_addr(prev_node);
-        find_and_remove_from_list(prev_node->start);
-
         bst_remove_by_size(next_node); bst_remove_by_addr(next_node);
-        find_and_remove_from_list(next_node->start);
 
         prev_node->num_of_pages += chunk_pages + next_node->num_of_pages;
-        free_block(next_node); // Free consumed node
+        kheap_free_block(next_node); // Free consumed node
         final_node = prev_node; 
     }
     else if (merge_prev) { // Merge PREV
         bst_remove_by_size(prev_node); bst_remove_by_addr(prev_node);
-        find_and_remove_from_list(prev_node->start);
 
         prev_node->num_of_pages += chunk_pages;
         final_node = prev_node;
     }
     else if (merge_next) { // Merge NEXT
         bst_remove_by_size(next_node); bst_remove_by_addr(next_node);
-        find_and_remove_from_list(next_node->start);
 
         next_node->start = chunk_start;
         next_node->num_of_pages += chunk_pages;
         final_node = next_node;
     }
     else { // No merge, create new node
-        struct PageChunkNode* new_chunk = (struct PageChunkNode*)alloc_block(sizeof(struct PageChunkNode));
-        if (new_chunk == NULL) panic("page_free: out of memory for PageChunk struct!");
+        struct PageChunkNode* new_chunk = (struct PageChunkNode*)kheap_alloc_block(sizeof(struct PageChunkNode));
+        if (new_chunk == NULL) panic("page_free: out of memory for PageChunkNode struct!");
         new_chunk->start = chunk_start;
         new_chunk->num_of_pages = chunk_pages;
         final_node = new_chunk;
@@ -322,18 +705,12 @@ void page_free(void* virtual_address)
     if (final_node->start + (final_node->num_of_pages * PAGE_SIZE) == kheapPageAllocBreak) {
         kheapPageAllocBreak = final_node->start;
         // If we merged or created, we must free the metadata node to return memory to OS
-        free_block(final_node); 
+        kheap_free_block(final_node); 
     }
     else {
         // Add to BSTs
         bst_insert_by_size(final_node);
         bst_insert_by_addr(final_node);
-        
-        // Add to List (Create separate struct for List)
-        struct PageChunk* new_list_node = (struct PageChunk*)alloc_block(sizeof(struct PageChunk));
-        new_list_node->start = final_node->start;
-        new_list_node->num_of_pages = final_node->num_of_pages;
-        LIST_INSERT_HEAD(&kheap_page_free_list, new_list_node);
     }
 }
 void kfree(void* virtual_address)
@@ -345,9 +722,10 @@ void kfree(void* virtual_address)
     if (virtual_address == NULL) return;
 
     uint32 va = (uint32)virtual_address;
+    KHEAP_TRACE(KHEAP_TRACE_FREE, va, kheap_allocation_size(va), virtual_address);
     // Block Allocator Range
     if (va >= KERNEL_HEAP_START && va < dynAllocEnd) 
-        free_block(virtual_address);
+        kheap_free_block(virtual_address);
     // Page Allocator Range
     else if (va >= kheapPageAllocStart && va < KERNEL_HEAP_MAX)
         page_free(virtual_address);  
@@ -355,6 +733,262 @@ void kfree(void* virtual_address)
         panic("kfree() called on an invalid address %x", va);
 }
 
+//Free "n" objects that were allocated by kmalloc_blocks() (or kmalloc() of block sizes) in one batch
+void kfree_blocks(void* ptrs[], uint32 n)
+{
+	//traced as "n" kfree() calls (before freeing, to get the size of each block)
+	if (kheapTraceEnabled)
+	{
+		for (uint32 i = 0; i < n; i++)
+			KHEAP_TRACE(KHEAP_TRACE_FREE, ptrs[i], get_block_size(ptrs[i]), ptrs);
+	}
+	acquire_kspinlock(&kheap_da_lock);
+	free_blocks(ptrs, n);
+	kheap_wakeup_da_waiters();
+	release_kspinlock(&kheap_da_lock);
+}
+
+//=================================
+// RECLAIM UNDER MEMORY PRESSURE:
+//=================================
+//Give back to the frame lists what the kernel heap keeps after a burst of allocations:
+//	1. the blocks cached in the magazines of ALL CPUs (the DA unmaps the pages that become empty)
+//	2. the binned page runs, merged into the trees so the break drops as far as it can
+//	   (this also frees their PageChunkNode blocks)
+//NOTE: the kernel page tables of the heap range are NOT freed: they're allocated at boot for the
+//whole [KERNEL_BASE, 4GB) and shared by all page directories (a PDE copied in each of them),
+//so a table can't be dropped without walking every directory.
+//Returns the number of frames given back
+uint32 kheap_reclaim()
+{
+	struct freeFramesCounters before = calculate_available_frames();
+
+	drain_da_magazines();
+	drain_page_bins();
+
+	struct freeFramesCounters after = calculate_available_frames();
+	return (after.freeBuffered + after.freeNotBuffered) - (before.freeBuffered + before.freeNotBuffered);
+}
+
+//=================================
+// DA STATISTICS:
+//=================================
+//NOTE: blocks cached in the per-CPU magazines are counted as allocated
+void kheap_get_da_stats(struct DynAllocStats* stats)
+{
+	acquire_kspinlock(&kheap_da_lock);
+	get_dynalloc_stats(stats);
+	release_kspinlock(&kheap_da_lock);
+}
+
+//=================================
+// TRACE & INTEGRITY CHECK:
+//=================================
+//Print the traced calls, oldest first. An allocation that is not followed by a kfree of
+//the same va in the buffer is marked as a possible leak
+void kheap_print_trace()
+{
+	acquire_kspinlock(&kheap_trace_lock);
+	uint32 count = MIN(kheapTraceCount, KHEAP_TRACE_SIZE);
+	uint32 first = kheapTraceCount - count;
+	cprintf("kheap trace (%s): last %d of %d calls\n", kheapTraceEnabled ? "on" : "off", count, kheapTraceCount);
+	for (uint32 i = first; i < kheapTraceCount; i++)
+	{
+		struct KHeapTraceEntry* entry = &kheapTrace[i % KHEAP_TRACE_SIZE];
+		bool freed = 0;
+		if (entry->op == KHEAP_TRACE_ALLOC)
+		{
+			for (uint32 j = i + 1; j < kheapTraceCount && !freed; j++)
+			{
+				struct KHeapTraceEntry* later = &kheapTrace[j % KHEAP_TRACE_SIZE];
+				freed = (later->op == KHEAP_TRACE_FREE && later->va == entry->va);
+			}
+		}
+		cprintf("%s %x size = %d caller = %x %s\n", entry->op == KHEAP_TRACE_ALLOC ? "kmalloc" : "kfree  ",
+				entry->va, entry->size, entry->caller_eip,
+				(entry->op == KHEAP_TRACE_ALLOC && !freed) ? (entry->va == 0 ? "(failed)" : "(not freed)") : "");
+	}
+	release_kspinlock(&kheap_trace_lock);
+}
+
+// Check that the pages of a free range are neither mapped nor marked lazy (returns # errors)
+static int check_unmapped_range(uint32 start, uint32 num_of_pages, char* what)
+{
+	for (uint32 va = start; va < start + num_of_pages * PAGE_SIZE; va += PAGE_SIZE)
+	{
+		uint32* ptr_page_table = NULL;
+		get_page_table(ptr_page_directory, va, &ptr_page_table);
+		if (ptr_page_table != NULL && (ptr_page_table[PTX(va)] & (PERM_PRESENT | PERM_KHLAZY)) != 0)
+		{
+			cprintf("kheap: page %x of the %s at %x is still mapped\n", va, what, start);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// The binned run that starts at va (NULL if none)
+static struct PageChunkNode* find_binned_run(uint32 va)
+{
+	for (int i = 0; i < KHEAP_NUM_OF_PAGE_BINS; i++)
+	{
+		for (struct PageChunkNode* run = LIST_FIRST(&kheap_page_bins[i]); run != NULL; run = LIST_NEXT(run))
+		{
+			if (run->start == va)
+				return run;
+		}
+	}
+	return NULL;
+}
+
+// Check the allocated page range at va (up to limit): its 1st frame keeps its size and each
+// other page is either mapped with no size or not touched yet (kmalloc_lazy).
+// Returns its # pages (0 if there's no allocation at va) and adds the errors found to *errors
+static uint32 check_allocated_range(uint32 va, uint32 limit, int* errors)
+{
+	uint32* ptr_page_table = NULL;
+	struct FrameInfo* first_frame_info = get_frame_info(ptr_page_directory, va, &ptr_page_table);
+	if (first_frame_info == NULL || first_frame_info->num_of_allocated_pages == 0)
+		return 0;
+
+	uint32 num_of_pages = first_frame_info->num_of_allocated_pages;
+	if (first_frame_info->mapped_address != va)
+	{
+		cprintf("kheap: the frame of %x says it's mapped at %x\n", va, first_frame_info->mapped_address);
+		(*errors)++;
+	}
+	if (va + num_of_pages * PAGE_SIZE > limit)
+	{
+		cprintf("kheap: the allocation at %x (%d pages) overlaps a free range or the break\n", va, num_of_pages);
+		(*errors)++;
+		num_of_pages = (limit - va) / PAGE_SIZE;
+	}
+	for (uint32 i = 1; i < num_of_pages; i++)
+	{
+		uint32 page = va + i * PAGE_SIZE;
+		struct FrameInfo* frame_info = get_frame_info(ptr_page_directory, page, &ptr_page_table);
+		if (frame_info == NULL)
+		{
+			if (ptr_page_table == NULL || (ptr_page_table[PTX(page)] & PERM_KHLAZY) == 0)
+			{
+				cprintf("kheap: page %x of the allocation at %x is not mapped\n", page, va);
+				(*errors)++;
+			}
+		}
+		else if (frame_info->num_of_allocated_pages != 0 || frame_info->mapped_address != page)
+		{
+			cprintf("kheap: page %x of the allocation at %x has a wrong frame info\n", page, va);
+			(*errors)++;
+		}
+	}
+	return num_of_pages;
+}
+
+//Verify the kernel heap:
+//	1. the invariants of both trees (order, links, AVL heights, max_pages_addr, same nodes)
+//	2. each free chunk/binned run is inside [start, break), unmapped, merged & not overlapping
+//	3. each page of [start, break) is either free or in an allocation of the size that its 1st
+//	   frame keeps (FrameInfo.num_of_allocated_pages); any other page is reported as leaked
+//	4. the page lists & the free blocks of the dynamic allocator
+//NOTE: the page allocator has no lock, so nothing else should use the kernel heap meanwhile.
+//Returns the number of errors found
+int kheap_check()
+{
+	int errors = 0;
+	uint32 num_of_chunks = 0, num_of_free_pages = 0;
+	errors += bst_check_trees(&num_of_chunks);
+
+	uint32 prev_end = 0;
+	for (struct PageChunkNode* node = bst_first_by_addr(); node != NULL; node = bst_next_by_addr(node))
+	{
+		uint32 end = node->start + node->num_of_pages * PAGE_SIZE;
+		if (node->num_of_pages == 0 || node->start % PAGE_SIZE != 0 || node->start < kheapPageAllocStart || end > kheapPageAllocBreak)
+		{
+			cprintf("kheap: free chunk %x (%d pages) is outside [%x, %x)\n", node->start, node->num_of_pages, kheapPageAllocStart, kheapPageAllocBreak);
+			errors++;
+		}
+		else if (end == kheapPageAllocBreak)
+		{
+			cprintf("kheap: free chunk %x is not merged with the break\n", node->start);
+			errors++;
+		}
+		if (prev_end > node->start)
+		{
+			cprintf("kheap: free chunk %x overlaps the previous one\n", node->start);
+			errors++;
+		}
+		else if (prev_end == node->start)
+		{
+			cprintf("kheap: free chunk %x is not merged with the previous one\n", node->start);
+			errors++;
+		}
+		errors += check_unmapped_range(node->start, node->num_of_pages, "free chunk");
+		num_of_free_pages += node->num_of_pages;
+		prev_end = end;
+	}
+
+	for (int i = 0; i < KHEAP_NUM_OF_PAGE_BINS; i++)
+	{
+		for (struct PageChunkNode* run = LIST_FIRST(&kheap_page_bins[i]); run != NULL; run = LIST_NEXT(run))
+		{
+			uint32 end = run->start + run->num_of_pages * PAGE_SIZE;
+			struct PageChunkNode* prev = bst_find_prev_neighbor(run->start + 1);
+			struct PageChunkNode* next = bst_find_next_neighbor(run->start);
+			if (run->num_of_pages != (1 << i) || run->start < kheapPageAllocStart || end > kheapPageAllocBreak
+				|| (prev != NULL && prev->start + prev->num_of_pages * PAGE_SIZE > run->start)
+				|| (next != NULL && next->start < end))
+			{
+				cprintf("kheap: binned run %x (%d pages) in bin %d is invalid or overlaps a free chunk\n", run->start, run->num_of_pages, i);
+				errors++;
+			}
+			errors += check_unmapped_range(run->start, run->num_of_pages, "binned run");
+			num_of_free_pages += run->num_of_pages;
+		}
+	}
+
+	// walk [start, break): free chunks & binned runs are skipped, the rest must be allocated ranges
+	uint32 num_of_allocs = 0, num_of_alloc_pages = 0, num_of_leaked_pages = 0;
+	struct PageChunkNode* next_free = bst_first_by_addr();
+	uint32 va = kheapPageAllocStart;
+	while (va < kheapPageAllocBreak)
+	{
+		while (next_free != NULL && next_free->start < va)
+			next_free = bst_next_by_addr(next_free);
+		if (next_free != NULL && next_free->start == va)
+		{
+			va += next_free->num_of_pages * PAGE_SIZE;
+			continue;
+		}
+		struct PageChunkNode* run = find_binned_run(va);
+		if (run != NULL)
+		{
+			va += run->num_of_pages * PAGE_SIZE;
+			continue;
+		}
+		uint32 limit = (next_free != NULL) ? next_free->start : kheapPageAllocBreak;
+		uint32 num_of_pages = check_allocated_range(va, limit, &errors);
+		if (num_of_pages == 0)
+		{
+			cprintf("kheap: page %x is neither free nor the start of an allocation (leaked)\n", va);
+			errors++;
+			num_of_leaked_pages++;
+			va += PAGE_SIZE;
+			continue;
+		}
+		num_of_allocs++;
+		num_of_alloc_pages += num_of_pages;
+		va += num_of_pages * PAGE_SIZE;
+	}
+
+	acquire_kspinlock(&kheap_da_lock);
+	errors += check_dynalloc_integrity();
+	release_kspinlock(&kheap_da_lock);
+
+	cprintf("kheap: %d free chunks, %d free pages, %d allocations of %d pages, %d leaked pages: %d errors\n",
+			num_of_chunks + num_of_binned_runs(), num_of_free_pages, num_of_allocs, num_of_alloc_pages, num_of_leaked_pages, errors);
+	return errors;
+}
+
 //=================================
 // [3] FIND VA OF GIVEN PA:
 //=================================
@@ -423,34 +1057,89 @@ static uint32 kheap_get_allocated_size(void* virtual_address)
         return 0; 
     return (fi->num_of_allocated_pages * PAGE_SIZE);
 }
-void *krealloc(void *virtual_address, uint32 new_size)
+// Grow the page allocation at va from old_pages to new_pages without moving it: take the extra
+// pages from the free chunk right after it or from the break, and map only them.
+// Returns 0 if there's no room after it (or no memory).
+static bool grow_in_place(uint32 va, uint32 old_pages, uint32 new_pages)
 {
-	//TODO: [PROJECT'25.BONUS#2] KERNEL REALLOC - krealloc
-	//Your code is here
-	//Comment the following line
-	// panic("krealloc() is not implemented yet...!!");
-    if(virtual_address == NULL)
-        return kmalloc(new_size);
-    if(new_size == 0) {
-        kfree(virtual_address);
+    uint32 end = va + (old_pages * PAGE_SIZE);
+    uint32 extra_pages = new_pages - old_pages;
+
+    if (end == kheapPageAllocBreak) {
+        if (kheapPageAllocBreak + (extra_pages * PAGE_SIZE) > KERNEL_HEAP_MAX)
+            return 0;
+        if (map_kheap_pages(end, extra_pages) != 0)
+            return 0;
+        kheapPageAllocBreak += (extra_pages * PAGE_SIZE);
+    }
+    else {
+        struct PageChunkNode* next_node = bst_find_next_neighbor(va);
+        if (next_node == NULL || next_node->start != end || next_node->num_of_pages < extra_pages)
+            return 0;
+        if (map_kheap_pages(end, extra_pages) != 0)
+            return 0;
+
+        bst_remove_by_size(next_node);
+        bst_remove_by_addr(next_node);
+        if (next_node->num_of_pages > extra_pages) {
+            next_node->start += (extra_pages * PAGE_SIZE);
+            next_node->num_of_pages -= extra_pages;
+            bst_insert_by_size(next_node);
+            bst_insert_by_addr(next_node);
+        }
+        else {
+            kheap_free_block(next_node);
+        }
+    }
+
+    set_allocation_size_info(va, new_pages);
+    return 1;
+}
+
+// Move the page allocation at va to a new range of new_pages pages by moving its page table
+// entries (cut_paste_pages), so its frames are reused as is, then map only the extra pages.
+// Returns the new va or NULL (the allocation is unchanged) if there's no room/memory.
+static void* move_and_grow(uint32 va, uint32 old_pages, uint32 new_pages)
+{
+    uint32 new_va = reserve_page_run(new_pages);
+    if (new_va == 0)
+        return NULL;
+
+    if (map_kheap_pages(new_va + (old_pages * PAGE_SIZE), new_pages - old_pages) != 0) {
+        release_free_run(new_va, new_pages);
         return NULL;
     }
-    
+    int ret = cut_paste_pages(ptr_page_directory, va, new_va, old_pages);
+    assert(ret == 0);
+
+    set_allocation_size_info(new_va, new_pages);
+    release_free_run(va, old_pages);
+    return (void*)new_va;
+}
+
+// Resize the (non-NULL) allocation at virtual_address to new_size (> 0). Not traced: it only uses the
+// allocators themselves (not kmalloc/kfree), so krealloc() traces the whole call once
+static void* resize_allocation(void *virtual_address, uint32 new_size)
+{
     uint32 va = (uint32)virtual_address;
     
     // 1. Block Allocator Logic
     if (va >= KERNEL_HEAP_START && va < dynAllocEnd) {
         if (new_size <= DYN_ALLOC_MAX_BLOCK_SIZE) {
-             return realloc_block(virtual_address, new_size);
+             acquire_kspinlock(&kheap_da_lock);
+             void* new_ptr = realloc_block(virtual_address, new_size);
+             kheap_wakeup_da_waiters();
+             release_kspinlock(&kheap_da_lock);
+             return new_ptr;
         } 
         else {
              // Grow from Block to Page
-             void* new_ptr = kmalloc(new_size);
+             void* new_ptr = page_allocator_fast(new_size);
              if (!new_ptr) return NULL;
              
              uint32 old_size = get_block_size(virtual_address); 
              memcpy(new_ptr, virtual_address, old_size);
-             free_block(virtual_address);
+             kheap_free_block(virtual_address);
              return new_ptr;
         }
     }
@@ -458,11 +1147,11 @@ void *krealloc(void *virtual_address, uint32 new_size)
     else if (va >= kheapPageAllocStart && va < KERNEL_HEAP_MAX) {
         if (new_size <= DYN_ALLOC_MAX_BLOCK_SIZE) {
             // Shrink from Page to Block
-            void* new_ptr = kmalloc(new_size);
+            void* new_ptr = kheap_alloc_block(new_size);
             if (!new_ptr) return NULL;
             
             memcpy(new_ptr, virtual_address, new_size); 
-            kfree(virtual_address);
+            page_free(virtual_address);
             return new_ptr;
         }
         else {
@@ -483,19 +1172,47 @@ void *krealloc(void *virtual_address, uint32 new_size)
                 uint32* ptr_table;
                 struct FrameInfo* fi = get_frame_info(ptr_page_directory, va, &ptr_table);
                 fi->num_of_allocated_pages = new_pages;
+                if (ptr_table[PTX(va)] & PERM_KHLAZY)
+                    set_lazy_marks(va + (new_pages * PAGE_SIZE), diff, 0);
 
+                // the cut tail becomes free space
+                release_free_run(va + (new_pages * PAGE_SIZE), diff);
                 return virtual_address; 
             } 
             else {
-                // Grow in place
-                void* new_ptr = kmalloc(new_size);
-                if (!new_ptr) return NULL;
-                memcpy(new_ptr, virtual_address, old_size);
-                kfree(virtual_address);
-                return new_ptr;
+                // Grow in place (free chunk after it or the break)
+                if (grow_in_place(va, old_pages, new_pages))
+                    return virtual_address;
+
+                // Otherwise move its frames to a new range (no copy)
+                return move_and_grow(va, old_pages, new_pages);
             }
         }
     }
     
     return NULL;
 }
+
+void *krealloc(void *virtual_address, uint32 new_size)
+{
+	//TODO: [PROJECT'25.BONUS#2] KERNEL REALLOC - krealloc
+	//Your code is here
+	//Comment the following line
+	// panic("krealloc() is not implemented yet...!!");
+    if(virtual_address == NULL)
+        return kmalloc(new_size);
+    if(new_size == 0) {
+        kfree(virtual_address);
+        return NULL;
+    }
+
+    uint32 old_size = kheapTraceEnabled ? kheap_allocation_size((uint32)virtual_address) : 0;
+    void* new_ptr = resize_allocation(virtual_address, new_size);
+    // traced as a kfree of the old allocation then a kmalloc of the new one
+    // (nothing on failure: the old allocation is kept as is)
+    if (new_ptr != NULL) {
+        KHEAP_TRACE(KHEAP_TRACE_FREE, virtual_address, old_size, virtual_address);
+        KHEAP_TRACE(KHEAP_TRACE_ALLOC, new_ptr, new_size, virtual_address);
+    }
+    return new_ptr;
+}
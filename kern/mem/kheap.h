@@ -28,36 +28,75 @@ static inline void set_kheap_strategy(uint32 strategy){kheapPlacementStrategy =
 static inline uint32 get_kheap_strategy(){return kheapPlacementStrategy ;}
 //***********************************
 
+//Optional tracing of kmalloc/kfree to debug leaks: when enabled, each call is recorded with its
+//size & caller in a ring buffer that keeps the last KHEAP_TRACE_SIZE calls.
+//When disabled, it costs a single test of kheapTraceEnabled per call.
+#define KHEAP_TRACE_SIZE	256
+#define KHEAP_TRACE_ALLOC	1
+#define KHEAP_TRACE_FREE	2
+
+struct KHeapTraceEntry
+{
+	uint32 op;			//KHEAP_TRACE_ALLOC or KHEAP_TRACE_FREE
+	uint32 va;
+	uint32 size;		//in bytes: requested (alloc) or allocated (free)
+	uint32 caller_eip;	//return address into the caller of kmalloc()/kfree()
+};
+
+extern bool kheapTraceEnabled;
+static inline void set_kheap_trace(bool enable){kheapTraceEnabled = enable;}
+static inline bool get_kheap_trace(){return kheapTraceEnabled ;}
+//***********************************
+
+//Per-CPU magazines of free blocks in front of the dynamic allocator.
+//Only worth it with more than one CPU, otherwise each call just takes kheap_da_lock
+#define KHEAP_USE_DA_MAGAZINES	(NCPUS > 1)
+#define KHEAP_DA_MAGAZINE_SIZE	16								//max cached blocks per CPU per block size
+#define KHEAP_DA_MAGAZINE_BATCH	(KHEAP_DA_MAGAZINE_SIZE / 2)	//blocks moved per refill/flush from/to the shared lists
+
+//Free runs of exactly 1, 2, 4 & 8 pages are kept in bins in front of the trees (CUSTOM FIT only),
+//so the most common page allocations are O(1) pops. Binned runs are not merged with their neighbours
+//till the bins are drained (before failing an allocation, on shrinking the break or on changing strategy)
+#define KHEAP_NUM_OF_PAGE_BINS	4		//bin i holds free runs of (1 << i) pages
+#define KHEAP_PAGE_BIN_MAX_RUNS	32		//max runs per bin (the extra runs go to the trees)
+
 struct PageChunkNode
 {
     uint32 start;
     uint32 num_of_pages; 
     struct PageChunkNode *parent_size, *left_size, *right_size;
     struct PageChunkNode *parent_addr, *left_addr, *right_addr;
+    int height_size, height_addr;   // AVL heights of the subtrees rooted at this node (in each tree)
+    uint32 max_pages_addr;          // largest num_of_pages in the subtree rooted at this node (address tree)
+    LIST_ENTRY(PageChunkNode) prev_next_info;	// link in kheap_page_bins[] (a binned run is in none of the trees)
 };
-
-struct PageChunk
-{
-    uint32 start;      // The starting virtual address of the hole
-    uint32 num_of_pages; // number of pages in the hole
-    LIST_ENTRY(PageChunk) prev_next_info; // Link for the free list
-};
-
-// The head of the free list
-LIST_HEAD(PageChunk_List, PageChunk);
-extern struct PageChunk_List kheap_page_free_list;
+LIST_HEAD(PageChunkNode_List, PageChunkNode);
 
 // fast lists ( trees )
 // Root of the tree ordered by num_of_pages
 extern struct PageChunkNode* kheap_free_tree_by_size;
 // Root of the tree ordered by start address
 extern struct PageChunkNode* kheap_free_tree_by_addr;
+// Bins of the small free runs
+extern struct PageChunkNode_List kheap_page_bins[KHEAP_NUM_OF_PAGE_BINS];
 //***********************************
 void kheap_init();
 
 void* kmalloc(unsigned int size);
+void* kmalloc_wait(unsigned int size);		//kmalloc() that sleeps instead of failing when the block allocator is full
+void* kmalloc_lazy(unsigned int size);		//kmalloc() whose pages are mapped (zeroed) on first touch
+int kheap_lazy_fault(uint32 fault_va);		//map the kmalloc_lazy() page at fault_va (returns 0 if it's not one)
+uint32 kheap_reclaim();						//give cached blocks & free page runs back under memory pressure (returns # frames freed)
 void kfree(void* virtual_address);
 void *krealloc(void *virtual_address, unsigned int new_size);
+uint32 kmalloc_blocks(unsigned int size, uint32 n, void* out[]);	//batched kmalloc() of "n" objects of the same (block) size
+void kfree_blocks(void* ptrs[], uint32 n);							//batched kfree() of "n" block objects
+
+struct DynAllocStats;
+void kheap_get_da_stats(struct DynAllocStats* stats);	//snapshot of the kernel heap block allocator statistics
+
+void kheap_print_trace();	//print the traced kmalloc/kfree calls (oldest first)
+int kheap_check();			//verify the trees, the bins, the allocated ranges & the DA (returns # errors found)
 
 unsigned int kheap_virtual_address(unsigned int physical_address);
 unsigned int kheap_physical_address(unsigned int virtual_address);
@@ -1,16 +1,27 @@
 #include "kheap_bst.h"
 #include <inc/types.h>
 #include <inc/assert.h>
+#include <inc/stdio.h>
 
 extern struct PageChunkNode* kheap_free_tree_by_size;
 extern struct PageChunkNode* kheap_free_tree_by_addr;
 
+// Both trees are AVL trees: after each insert/remove, the heights are updated from the
+// changed node up to the root, rotating any node whose subtrees differ by more than 1 in height.
+// So searches, inserts & removes stay O(log n) whatever the order of kmalloc/kfree is.
+// The address tree also keeps, in each node, the largest chunk of its subtree (max_pages_addr)
+// so that "lowest address that fits" (first/next fit) is answered in O(log n) as well.
+// (a node is always removed from both trees before its start/num_of_pages is changed)
+
 //==============//
 //  Size Tree   //
 //==============//
 
+static void bst_rebalance_size(struct PageChunkNode* node);
+
 void bst_insert_by_size(struct PageChunkNode* node) {
     node->left_size = node->right_size = node->parent_size = NULL;
+    node->height_size = 1;
     if (kheap_free_tree_by_size == NULL) {
         kheap_free_tree_by_size = node;
         return;
@@ -21,7 +32,7 @@ void bst_insert_by_size(struct PageChunkNode* node) {
             if (current->right_size == NULL) {
                 current->right_size = node;
                 node->parent_size = current;
-                return;
+                break;
             }
             current = current->right_size;
         }
@@ -29,11 +40,12 @@ void bst_insert_by_size(struct PageChunkNode* node) {
             if (current->left_size == NULL) {
                 current->left_size = node;
                 node->parent_size = current;
-                return;
+                break;
             }
             current = current->left_size;
         }
     }
+    bst_rebalance_size(node->parent_size);
 }
 
 static void bst_replace_node_in_parent_size(struct PageChunkNode* node, struct PageChunkNode* new_node) {
@@ -51,6 +63,65 @@ static void bst_replace_node_in_parent_size(struct PageChunkNode* node, struct P
     }
 }
 
+static int bst_height_size(struct PageChunkNode* node) {
+    return (node == NULL) ? 0 : node->height_size;
+}
+
+static void bst_update_height_size(struct PageChunkNode* node) {
+    node->height_size = 1 + MAX(bst_height_size(node->left_size), bst_height_size(node->right_size));
+}
+
+// rotate the subtree rooted at node to the left and return its new root
+static struct PageChunkNode* bst_rotate_left_size(struct PageChunkNode* node) {
+    struct PageChunkNode* pivot = node->right_size;
+    node->right_size = pivot->left_size;
+    if (pivot->left_size != NULL) {
+        pivot->left_size->parent_size = node;
+    }
+    bst_replace_node_in_parent_size(node, pivot);
+    pivot->left_size = node;
+    node->parent_size = pivot;
+    bst_update_height_size(node);
+    bst_update_height_size(pivot);
+    return pivot;
+}
+
+// rotate the subtree rooted at node to the right and return its new root
+static struct PageChunkNode* bst_rotate_right_size(struct PageChunkNode* node) {
+    struct PageChunkNode* pivot = node->left_size;
+    node->left_size = pivot->right_size;
+    if (pivot->right_size != NULL) {
+        pivot->right_size->parent_size = node;
+    }
+    bst_replace_node_in_parent_size(node, pivot);
+    pivot->right_size = node;
+    node->parent_size = pivot;
+    bst_update_height_size(node);
+    bst_update_height_size(pivot);
+    return pivot;
+}
+
+// fix heights & balance from the given node up to the root
+static void bst_rebalance_size(struct PageChunkNode* node) {
+    while (node != NULL) {
+        bst_update_height_size(node);
+        int balance = bst_height_size(node->left_size) - bst_height_size(node->right_size);
+        if (balance > 1) {
+            if (bst_height_size(node->left_size->left_size) < bst_height_size(node->left_size->right_size)) {
+                bst_rotate_left_size(node->left_size);
+            }
+            node = bst_rotate_right_size(node);
+        }
+        else if (balance < -1) {
+            if (bst_height_size(node->right_size->right_size) < bst_height_size(node->right_size->left_size)) {
+                bst_rotate_right_size(node->right_size);
+            }
+            node = bst_rotate_left_size(node);
+        }
+        node = node->parent_size;
+    }
+}
+
 static struct PageChunkNode* bst_find_min_size(struct PageChunkNode* node) {
     while (node->left_size != NULL) {
         node = node->left_size;
@@ -59,23 +130,32 @@ static struct PageChunkNode* bst_find_min_size(struct PageChunkNode* node) {
 }
 
 void bst_remove_by_size(struct PageChunkNode* node) {
+    // lowest node whose subtree has changed (i.e. where rebalancing starts)
+    struct PageChunkNode* changed;
     if (node->left_size == NULL) {
+        changed = node->parent_size;
         bst_replace_node_in_parent_size(node, node->right_size);
     } 
     else if (node->right_size == NULL) {
+        changed = node->parent_size;
         bst_replace_node_in_parent_size(node, node->left_size);
     }
     else {
         struct PageChunkNode* successor = bst_find_min_size(node->right_size);
         if (successor->parent_size != node) {
+            changed = successor->parent_size;
             bst_replace_node_in_parent_size(successor, successor->right_size);
             successor->right_size = node->right_size;
             successor->right_size->parent_size = successor;
         }
+        else {
+            changed = successor;
+        }
         bst_replace_node_in_parent_size(node, successor);
         successor->left_size = node->left_size;
         successor->left_size->parent_size = successor;
     }
+    bst_rebalance_size(changed);
 }
 
 struct PageChunkNode* bst_find_exact_fit(uint32 pages_needed) {
@@ -109,12 +189,32 @@ struct PageChunkNode* bst_find_worst_fit(uint32 pages_needed) {
     return worst_fit;
 }
 
+// smallest chunk that fits (lower bound on size)
+struct PageChunkNode* bst_find_best_fit(uint32 pages_needed) {
+    struct PageChunkNode* current = kheap_free_tree_by_size;
+    struct PageChunkNode* best_fit = NULL;
+    while (current != NULL) {
+        if (current->num_of_pages >= pages_needed) {
+            best_fit = current;
+            current = current->left_size;
+        }
+        else {
+            current = current->right_size;
+        }
+    }
+    return best_fit;
+}
+
 //==============//
 // Address Tree //
 //==============//
 
+static void bst_rebalance_addr(struct PageChunkNode* node);
+
 void bst_insert_by_addr(struct PageChunkNode* node) {
     node->left_addr = node->right_addr = node->parent_addr = NULL;
+    node->height_addr = 1;
+    node->max_pages_addr = node->num_of_pages;
     if (kheap_free_tree_by_addr == NULL) {
         kheap_free_tree_by_addr = node;
         return;
@@ -125,7 +225,7 @@ void bst_insert_by_addr(struct PageChunkNode* node) {
             if (current->right_addr == NULL) {
                 current->right_addr = node;
                 node->parent_addr = current;
-                return;
+                break;
             }
             current = current->right_addr;
         } 
@@ -133,11 +233,12 @@ void bst_insert_by_addr(struct PageChunkNode* node) {
             if (current->left_addr == NULL) {
                 current->left_addr = node;
                 node->parent_addr = current;
-                return;
+                break;
             }
             current = current->left_addr;
         }
     }
+    bst_rebalance_addr(node->parent_addr);
 }
 
 static void bst_replace_node_in_parent_addr(struct PageChunkNode* node, struct PageChunkNode* new_node) {
@@ -155,6 +256,71 @@ static void bst_replace_node_in_parent_addr(struct PageChunkNode* node, struct P
     }
 }
 
+static int bst_height_addr(struct PageChunkNode* node) {
+    return (node == NULL) ? 0 : node->height_addr;
+}
+
+static uint32 bst_max_pages_addr(struct PageChunkNode* node) {
+    return (node == NULL) ? 0 : node->max_pages_addr;
+}
+
+// update both the height & the largest chunk of the subtree rooted at node from its children
+static void bst_update_height_addr(struct PageChunkNode* node) {
+    node->height_addr = 1 + MAX(bst_height_addr(node->left_addr), bst_height_addr(node->right_addr));
+    node->max_pages_addr = MAX(node->num_of_pages, MAX(bst_max_pages_addr(node->left_addr), bst_max_pages_addr(node->right_addr)));
+}
+
+// rotate the subtree rooted at node to the left and return its new root
+static struct PageChunkNode* bst_rotate_left_addr(struct PageChunkNode* node) {
+    struct PageChunkNode* pivot = node->right_addr;
+    node->right_addr = pivot->left_addr;
+    if (pivot->left_addr != NULL) {
+        pivot->left_addr->parent_addr = node;
+    }
+    bst_replace_node_in_parent_addr(node, pivot);
+    pivot->left_addr = node;
+    node->parent_addr = pivot;
+    bst_update_height_addr(node);
+    bst_update_height_addr(pivot);
+    return pivot;
+}
+
+// rotate the subtree rooted at node to the right and return its new root
+static struct PageChunkNode* bst_rotate_right_addr(struct PageChunkNode* node) {
+    struct PageChunkNode* pivot = node->left_addr;
+    node->left_addr = pivot->right_addr;
+    if (pivot->right_addr != NULL) {
+        pivot->right_addr->parent_addr = node;
+    }
+    bst_replace_node_in_parent_addr(node, pivot);
+    pivot->right_addr = node;
+    node->parent_addr = pivot;
+    bst_update_height_addr(node);
+    bst_update_height_addr(pivot);
+    return pivot;
+}
+
+// fix heights & balance from the given node up to the root
+static void bst_rebalance_addr(struct PageChunkNode* node) {
+    while (node != NULL) {
+        bst_update_height_addr(node);
+        int balance = bst_height_addr(node->left_addr) - bst_height_addr(node->right_addr);
+        if (balance > 1) {
+            if (bst_height_addr(node->left_addr->left_addr) < bst_height_addr(node->left_addr->right_addr)) {
+                bst_rotate_left_addr(node->left_addr);
+            }
+            node = bst_rotate_right_addr(node);
+        }
+        else if (balance < -1) {
+            if (bst_height_addr(node->right_addr->right_addr) < bst_height_addr(node->right_addr->left_addr)) {
+                bst_rotate_right_addr(node->right_addr);
+            }
+            node = bst_rotate_left_addr(node);
+        }
+        node = node->parent_addr;
+    }
+}
+
 static struct PageChunkNode* bst_find_min_addr(struct PageChunkNode* node) {
     while (node->left_addr != NULL) {
         node = node->left_addr;
@@ -163,23 +329,32 @@ static struct PageChunkNode* bst_find_min_addr(struct PageChunkNode* node) {
 }
 
 void bst_remove_by_addr(struct PageChunkNode* node) {
+    // lowest node whose subtree has changed (i.e. where rebalancing starts)
+    struct PageChunkNode* changed;
     if (node->left_addr == NULL) {
+        changed = node->parent_addr;
         bst_replace_node_in_parent_addr(node, node->right_addr);
     } 
     else if (node->right_addr == NULL) {
+        changed = node->parent_addr;
         bst_replace_node_in_parent_addr(node, node->left_addr);
     }
     else {
         struct PageChunkNode* successor = bst_find_min_addr(node->right_addr);
         if (successor->parent_addr != node) {
+            changed = successor->parent_addr;
             bst_replace_node_in_parent_addr(successor, successor->right_addr);
             successor->right_addr = node->right_addr;
             successor->right_addr->parent_addr = successor;
         }
+        else {
+            changed = successor;
+        }
         bst_replace_node_in_parent_addr(node, successor);
         successor->left_addr = node->left_addr;
         successor->left_addr->parent_addr = successor;
     }
+    bst_rebalance_addr(changed);
 }
 
 struct PageChunkNode* bst_find_prev_neighbor(uint32 addr) {
@@ -210,4 +385,153 @@ struct PageChunkNode* bst_find_next_neighbor(uint32 addr) {
         }
     }
     return neighbor;
-}
\ No newline at end of file
+}
+
+struct PageChunkNode* bst_first_by_addr() {
+    if (kheap_free_tree_by_addr == NULL) {
+        return NULL;
+    }
+    return bst_find_min_addr(kheap_free_tree_by_addr);
+}
+
+struct PageChunkNode* bst_next_by_addr(struct PageChunkNode* node) {
+    if (node->right_addr != NULL) {
+        return bst_find_min_addr(node->right_addr);
+    }
+    while (node->parent_addr != NULL && node == node->parent_addr->right_addr) {
+        node = node->parent_addr;
+    }
+    return node->parent_addr;
+}
+
+// lowest-addressed chunk that fits in the subtree rooted at node (skips subtrees with no chunk that fits)
+static struct PageChunkNode* bst_first_fit_in(struct PageChunkNode* node, uint32 pages_needed) {
+    while (node != NULL && node->max_pages_addr >= pages_needed) {
+        if (bst_max_pages_addr(node->left_addr) >= pages_needed) {
+            node = node->left_addr;
+        }
+        else if (node->num_of_pages >= pages_needed) {
+            return node;
+        }
+        else {
+            node = node->right_addr;
+        }
+    }
+    return NULL;
+}
+
+struct PageChunkNode* bst_find_first_fit(uint32 pages_needed) {
+    return bst_first_fit_in(kheap_free_tree_by_addr, pages_needed);
+}
+
+// lowest-addressed chunk that fits among the chunks starting at or after addr:
+// walks down towards addr and, on the way, searches only the right subtrees left behind (at most one per level)
+struct PageChunkNode* bst_find_first_fit_from(uint32 addr, uint32 pages_needed) {
+    struct PageChunkNode* current = kheap_free_tree_by_addr;
+    // nodes >= addr passed on the way down, from the nearest to addr upwards
+    struct PageChunkNode* path[32];
+    int depth = 0;
+    while (current != NULL) {
+        if (current->start >= addr) {
+            path[depth++] = current;
+            current = current->left_addr;
+        }
+        else {
+            current = current->right_addr;
+        }
+    }
+    while (depth > 0) {
+        current = path[--depth];
+        if (current->num_of_pages >= pages_needed) {
+            return current;
+        }
+        struct PageChunkNode* found = bst_first_fit_in(current->right_addr, pages_needed);
+        if (found != NULL) {
+            return found;
+        }
+    }
+    return NULL;
+}
+
+//==============//
+//  Invariants  //
+//==============//
+
+// check the subtree of the size tree rooted at node (keys within [lo, hi]); returns its height
+static int bst_check_size(struct PageChunkNode* node, struct PageChunkNode* parent, uint32 lo, uint32 hi, uint32* count, int* errors) {
+    if (node == NULL) {
+        return 0;
+    }
+    (*count)++;
+    if (node->parent_size != parent) {
+        cprintf("size tree: node %x has a wrong parent link\n", node->start);
+        (*errors)++;
+    }
+    if (node->num_of_pages < lo || node->num_of_pages > hi) {
+        cprintf("size tree: node %x (%d pages) is out of order\n", node->start, node->num_of_pages);
+        (*errors)++;
+    }
+    int hl = bst_check_size(node->left_size, node, lo, node->num_of_pages, count, errors);
+    int hr = bst_check_size(node->right_size, node, node->num_of_pages, hi, count, errors);
+    if (node->height_size != 1 + MAX(hl, hr) || hl - hr > 1 || hr - hl > 1) {
+        cprintf("size tree: node %x has a wrong height or is unbalanced\n", node->start);
+        (*errors)++;
+    }
+    return 1 + MAX(hl, hr);
+}
+
+// check the subtree of the address tree rooted at node (starts within (lo, hi)); returns its height
+static int bst_check_addr(struct PageChunkNode* node, struct PageChunkNode* parent, uint32 lo, uint32 hi, uint32* count, int* errors) {
+    if (node == NULL) {
+        return 0;
+    }
+    (*count)++;
+    if (node->parent_addr != parent) {
+        cprintf("address tree: node %x has a wrong parent link\n", node->start);
+        (*errors)++;
+    }
+    if ((lo != 0 && node->start <= lo) || (hi != 0 && node->start >= hi)) {
+        cprintf("address tree: node %x is out of order\n", node->start);
+        (*errors)++;
+    }
+    int hl = bst_check_addr(node->left_addr, node, lo, node->start, count, errors);
+    int hr = bst_check_addr(node->right_addr, node, node->start, hi, count, errors);
+    if (node->height_addr != 1 + MAX(hl, hr) || hl - hr > 1 || hr - hl > 1) {
+        cprintf("address tree: node %x has a wrong height or is unbalanced\n", node->start);
+        (*errors)++;
+    }
+    if (node->max_pages_addr != MAX(node->num_of_pages, MAX(bst_max_pages_addr(node->left_addr), bst_max_pages_addr(node->right_addr)))) {
+        cprintf("address tree: node %x has a wrong max_pages_addr\n", node->start);
+        (*errors)++;
+    }
+    return 1 + MAX(hl, hr);
+}
+
+// Verify the order, links, heights & balance of both trees and that they hold the same nodes.
+// Returns the number of errors found (the number of chunks is set in *num_of_chunks)
+int bst_check_trees(uint32* num_of_chunks) {
+    int errors = 0;
+    uint32 count_size = 0, count_addr = 0;
+    bst_check_size(kheap_free_tree_by_size, NULL, 0, UINT_MAX, &count_size, &errors);
+    bst_check_addr(kheap_free_tree_by_addr, NULL, 0, 0, &count_addr, &errors);
+    if (count_size != count_addr) {
+        cprintf("trees: %d nodes by size but %d by address\n", count_size, count_addr);
+        errors++;
+    }
+    else {
+        // each node of the address tree must be linked in the size tree too
+        for (struct PageChunkNode* node = bst_first_by_addr(); node != NULL; node = bst_next_by_addr(node)) {
+            struct PageChunkNode* root = node;
+            uint32 depth = 0;
+            while (root->parent_size != NULL && depth++ < count_size) {
+                root = root->parent_size;
+            }
+            if (root != kheap_free_tree_by_size) {
+                cprintf("trees: node %x is not in the size tree\n", node->start);
+                errors++;
+            }
+        }
+    }
+    *num_of_chunks = count_addr;
+    return errors;
+}
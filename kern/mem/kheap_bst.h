@@ -12,7 +12,17 @@ void bst_remove_by_addr(struct PageChunkNode* node);
 // Allocator-specific search functions
 struct PageChunkNode* bst_find_exact_fit(uint32 pages_needed);
 struct PageChunkNode* bst_find_worst_fit(uint32 pages_needed);
+struct PageChunkNode* bst_find_best_fit(uint32 pages_needed);
+struct PageChunkNode* bst_find_first_fit(uint32 pages_needed);
+struct PageChunkNode* bst_find_first_fit_from(uint32 addr, uint32 pages_needed);
 struct PageChunkNode* bst_find_prev_neighbor(uint32 addr);
 struct PageChunkNode* bst_find_next_neighbor(uint32 addr);
 
+// In-order walk of the address tree (i.e. the free chunks sorted by address, derived on demand)
+struct PageChunkNode* bst_first_by_addr();
+struct PageChunkNode* bst_next_by_addr(struct PageChunkNode* node);
+
+// Integrity check of both trees (returns the number of errors found)
+int bst_check_trees(uint32* num_of_chunks);
+
 #endif /* FOS_KERN_KHEAP_BST_H_ */
\ No newline at end of file
@@ -53,6 +53,9 @@ void tlb_invalidate(uint32 *ptr_page_directory, void *virtual_address)
 //
 
 extern void initialize_disk_page_file();
+static void initialize_buddy_zone(uint32 first_free_frame);
+static inline bool is_buddy_frame_number(uint32 frame_number);
+static void initialize_frame_caches();
 void initialize_paging()
 {
 	// The example code here marks all frames_info as free.
@@ -71,9 +74,12 @@ void initialize_paging()
 	int i;
 	LIST_INIT(&MemFrameLists.free_frame_list);
 	LIST_INIT(&MemFrameLists.modified_frame_list);
+	MemFrameLists.num_of_free_buffered = 0;
+	LIST_INIT(&MemFrameLists.zeroed_frame_list);
 
 	//Initialize the corresponding lock
 	init_kspinlock(&MemFrameLists.mfllock, "Frame Info Lock");
+	initialize_frame_caches();
 
 	frames_info[0].references = 1;
 	frames_info[1].references = 1;
@@ -110,8 +116,13 @@ void initialize_paging()
 		frames_info[i].references = 1;
 	}
 
+	//the frames of the buddy zone are kept in its free blocks instead of the free_frame_list
+	initialize_buddy_zone(range_end/PAGE_SIZE);
+
 	for (i = range_end/PAGE_SIZE ; i < number_of_frames; i++)
 	{
+		if (is_buddy_frame_number(i))
+			continue;
 		initialize_frame_info(&(frames_info[i]));
 
 		//frames_info[i].references = 0;
@@ -134,6 +145,314 @@ void initialize_frame_info(struct FrameInfo *ptr_frame_info)
     ptr_frame_info->num_of_allocated_pages = 0;
 }
 
+//=========================================
+// BUDDY ALLOCATOR OF CONTIGUOUS FRAMES:
+//=========================================
+//The zone [buddyZoneStart, buddyZoneEnd) (frame numbers) starts at a multiple of 2^BUDDY_MAX_ORDER,
+//so the buddy of the block of 2^order frames at frame "fn" is simply at (fn ^ (1 << order)).
+//A block is split on allocation (its upper halves become free blocks) and merged with its free buddy
+//on free, as far as possible. Everything is protected by MemFrameLists.mfllock
+static struct FrameInfo_List buddyFreeBlocks[BUDDY_MAX_ORDER + 1];
+static uint32 buddyZoneStart = 0, buddyZoneEnd = 0;
+static uint32 buddyNumOfFreeFrames = 0;
+
+static inline bool is_buddy_frame_number(uint32 frame_number)
+{
+	return frame_number >= buddyZoneStart && frame_number < buddyZoneEnd;
+}
+
+static inline bool is_buddy_frame(struct FrameInfo *ptr_frame_info)
+{
+	return is_buddy_frame_number(to_frame_number(ptr_frame_info));
+}
+
+static void buddy_insert_free_block(uint32 frame_number, uint32 order)
+{
+	struct FrameInfo *ptr_frame_info = &frames_info[frame_number];
+	ptr_frame_info->is_buddy_free = 1;
+	ptr_frame_info->buddy_order = order;
+	LIST_INSERT_HEAD(&buddyFreeBlocks[order], ptr_frame_info);
+}
+
+static void buddy_remove_free_block(struct FrameInfo *ptr_frame_info)
+{
+	LIST_REMOVE(&buddyFreeBlocks[ptr_frame_info->buddy_order], ptr_frame_info);
+	ptr_frame_info->is_buddy_free = 0;
+}
+
+//Take the top 1/BUDDY_ZONE_FRACTION of the free frames (>= first_free_frame) as the buddy zone.
+//It's empty if the memory is too small to hold a single block of the largest order.
+static void initialize_buddy_zone(uint32 first_free_frame)
+{
+	for (int order = 0; order <= BUDDY_MAX_ORDER; order++)
+		LIST_INIT(&buddyFreeBlocks[order]);
+
+	uint32 max_block = 1 << BUDDY_MAX_ORDER;
+	buddyZoneEnd = ROUNDDOWN(number_of_frames, max_block);
+	buddyZoneStart = ROUNDDOWN(number_of_frames - number_of_frames / BUDDY_ZONE_FRACTION, max_block);
+	if (buddyZoneStart < first_free_frame)
+		buddyZoneStart = ROUNDUP(first_free_frame, max_block);
+	if (buddyZoneStart >= buddyZoneEnd)
+		buddyZoneStart = buddyZoneEnd = 0;
+
+	for (uint32 fn = buddyZoneStart; fn < buddyZoneEnd; fn += max_block)
+	{
+		for (uint32 i = 0; i < max_block; i++)
+			initialize_frame_info(&frames_info[fn + i]);
+		buddy_insert_free_block(fn, BUDDY_MAX_ORDER);
+	}
+	buddyNumOfFreeFrames = buddyZoneEnd - buddyZoneStart;
+}
+
+//Allocate a block of 2^order frames (the smallest free block that fits, split down to "order").
+//MUST be called while holding MemFrameLists.mfllock
+static struct FrameInfo* buddy_alloc(uint32 order)
+{
+	uint32 block_order = order;
+	while (block_order <= BUDDY_MAX_ORDER && LIST_EMPTY(&buddyFreeBlocks[block_order]))
+		block_order++;
+	if (block_order > BUDDY_MAX_ORDER)
+		return NULL;
+
+	struct FrameInfo *ptr_frame_info = LIST_FIRST(&buddyFreeBlocks[block_order]);
+	buddy_remove_free_block(ptr_frame_info);
+	uint32 frame_number = to_frame_number(ptr_frame_info);
+	while (block_order > order)
+	{
+		block_order--;
+		buddy_insert_free_block(frame_number + (1 << block_order), block_order);
+	}
+	for (uint32 i = 0; i < (1 << order); i++)
+		initialize_frame_info(&frames_info[frame_number + i]);
+	buddyNumOfFreeFrames -= (1 << order);
+	return ptr_frame_info;
+}
+
+//Free the block of 2^order frames at frame_number, merging it with its free buddies.
+//MUST be called while holding MemFrameLists.mfllock
+static void buddy_free(uint32 frame_number, uint32 order)
+{
+	buddyNumOfFreeFrames += (1 << order);
+	while (order < BUDDY_MAX_ORDER)
+	{
+		uint32 buddy_number = frame_number ^ (1 << order);
+		struct FrameInfo *ptr_buddy = &frames_info[buddy_number];
+		if (!is_buddy_frame_number(buddy_number) || !ptr_buddy->is_buddy_free || ptr_buddy->buddy_order != order)
+			break;
+		buddy_remove_free_block(ptr_buddy);
+		frame_number = MIN(frame_number, buddy_number);
+		order++;
+	}
+	buddy_insert_free_block(frame_number, order);
+}
+
+//Give back a single free frame to the buddy zone or to the free_frame_list.
+//MUST be called while holding MemFrameLists.mfllock
+static void insert_free_frame(struct FrameInfo *ptr_frame_info)
+{
+	if (is_buddy_frame(ptr_frame_info))
+		buddy_free(to_frame_number(ptr_frame_info), 0);
+	else
+		LIST_INSERT_HEAD(&MemFrameLists.free_frame_list, ptr_frame_info);
+}
+
+uint32 num_of_free_buddy_blocks(uint32 order)
+{
+	return (order <= BUDDY_MAX_ORDER) ? LIST_SIZE(&buddyFreeBlocks[order]) : 0;
+}
+
+//
+// Allocates 2^order physically contiguous frames (e.g. for DMA buffers).
+// *ptr_frame_info is set to the Frame_Info of the 1st one (the others follow it in frames_info).
+// Like allocate_frame(), the frames are NOT zeroed and their references are NOT incremented.
+// They can be given back either at once by free_contiguous_frames() or one by one by free_frame().
+//
+// RETURNS
+//   0 -- on success
+//   E_NO_MEM -- if there's no free block of this order (or bigger) in the buddy zone
+//
+int allocate_contiguous_frames(uint32 order, struct FrameInfo **ptr_frame_info)
+{
+	if (order > BUDDY_MAX_ORDER)
+		return E_NO_MEM;
+	bool lock_already_held = holding_kspinlock(&MemFrameLists.mfllock);
+	if (!lock_already_held)
+	{
+		acquire_kspinlock(&MemFrameLists.mfllock);
+	}
+	*ptr_frame_info = buddy_alloc(order);
+	if (!lock_already_held)
+	{
+		release_kspinlock(&MemFrameLists.mfllock);
+	}
+	return (*ptr_frame_info == NULL) ? E_NO_MEM : 0;
+}
+
+void free_contiguous_frames(struct FrameInfo *ptr_frame_info, uint32 order)
+{
+	uint32 frame_number = to_frame_number(ptr_frame_info);
+	if (!is_buddy_frame(ptr_frame_info) || frame_number % (1 << order) != 0)
+		panic("free_contiguous_frames: frame %d is not a block of order %d", frame_number, order);
+
+	bool lock_already_held = holding_kspinlock(&MemFrameLists.mfllock);
+	if (!lock_already_held)
+	{
+		acquire_kspinlock(&MemFrameLists.mfllock);
+	}
+	for (uint32 i = 0; i < (1 << order); i++)
+		initialize_frame_info(&frames_info[frame_number + i]);
+	buddy_free(frame_number, order);
+	if (!lock_already_held)
+	{
+		release_kspinlock(&MemFrameLists.mfllock);
+	}
+}
+
+//=========================================
+// PER-CPU CACHES OF FREE FRAMES:
+//=========================================
+//Each CPU keeps a small stack of free (already initialized) frames. allocate_frame/free_frame
+//pop/push it under its own lock (only contended when another CPU drains it) and only take mfllock
+//to refill/flush a batch of FRAME_CACHE_BATCH frames. Callers that already hold mfllock work on the
+//lists directly. Lock order: mfllock, then a cache lock (a cache lock is never held while taking mfllock)
+//NOTE: the cached frames are counted as free (calculate_available_frames) but are not in free_frame_list,
+//so whoever finds the lists empty drains the caches of ALL CPUs before failing (drain_frame_caches)
+struct FrameCache
+{
+	struct kspinlock lock;
+	uint32 count;
+	struct FrameInfo* frames[FRAME_CACHE_SIZE];
+};
+static struct FrameCache frameCaches[NCPUS];
+static bool frameCachesEnabled = USE_FRAME_CACHES;
+
+static void initialize_frame_caches()
+{
+	for (int i = 0; i < NCPUS; i++)
+	{
+		init_kspinlock(&frameCaches[i].lock, "Frame Cache Lock");
+		frameCaches[i].count = 0;
+	}
+}
+
+static void release_frame_mappings(struct FrameInfo *ptr_frame_info);
+
+//MUST be called with interrupts disabled (i.e. after pushcli) to stay on the same CPU
+static struct FrameCache* my_frame_cache()
+{
+	return &frameCaches[mycpu() - CPUS];
+}
+
+//Remove the first frame of free_frame_list and clear its info (NULL if none).
+//If it's empty, a frame of the pre-zeroed pool (used as a normal frame) or of the buddy zone is taken.
+//MUST be called while holding MemFrameLists.mfllock
+static struct FrameInfo* remove_free_frame()
+{
+	struct FrameInfo *ptr_frame_info = LIST_FIRST(&MemFrameLists.free_frame_list);
+	if (ptr_frame_info == NULL)
+	{
+		ptr_frame_info = LIST_FIRST(&MemFrameLists.zeroed_frame_list);
+		if (ptr_frame_info == NULL)
+			return buddy_alloc(0);
+		LIST_REMOVE(&MemFrameLists.zeroed_frame_list, ptr_frame_info);
+		return ptr_frame_info;
+	}
+
+	LIST_REMOVE(&MemFrameLists.free_frame_list, ptr_frame_info);
+
+	/******************* PAGE BUFFERING CODE *******************
+	 ***********************************************************/
+
+	if(ptr_frame_info->isBuffered)
+	{
+		MemFrameLists.num_of_free_buffered--;
+		/*MUST UN-COMMENT THIS LINE*/
+		//pt_clear_page_table_entry(ptr_frame_info->proc->env_page_directory,ptr_frame_info->va);
+	}
+
+	/**********************************************************
+	 ***********************************************************/
+
+	initialize_frame_info(ptr_frame_info);
+	return ptr_frame_info;
+}
+
+//Move the frames cached by ALL CPUs back to the frame lists.
+//MUST be called while holding MemFrameLists.mfllock
+static void drain_frame_caches()
+{
+	for (int i = 0; i < NCPUS; i++)
+	{
+		struct FrameCache* cache = &frameCaches[i];
+		acquire_kspinlock(&cache->lock);
+		while (cache->count > 0)
+			insert_free_frame(cache->frames[--cache->count]);
+		release_kspinlock(&cache->lock);
+	}
+}
+
+void flush_frame_caches()
+{
+	bool lock_already_held = holding_kspinlock(&MemFrameLists.mfllock);
+	if (!lock_already_held)
+	{
+		acquire_kspinlock(&MemFrameLists.mfllock);
+	}
+	drain_frame_caches();
+	if (!lock_already_held)
+	{
+		release_kspinlock(&MemFrameLists.mfllock);
+	}
+}
+
+//Switch the per-CPU frame caches on/off at run time (e.g. to test them with a single CPU).
+//They're drained when switched off
+void set_frame_caches(bool enable)
+{
+	acquire_kspinlock(&MemFrameLists.mfllock);
+	frameCachesEnabled = enable;
+	if (!enable)
+		drain_frame_caches();
+	release_kspinlock(&MemFrameLists.mfllock);
+}
+
+bool get_frame_caches()
+{
+	return frameCachesEnabled;
+}
+
+uint32 num_of_cached_frames()
+{
+	uint32 count = 0;
+	for (int i = 0; i < NCPUS; i++)
+		count += frameCaches[i].count;
+	return count;
+}
+
+//Refill the given (empty) cache of this CPU with a batch of frames and return one more frame for the caller.
+//If the lists are empty, the caches of the other CPUs are drained first.
+//MUST be called with interrupts disabled and NOT holding the cache lock (mfllock is taken before it)
+static struct FrameInfo* refill_frame_cache(struct FrameCache* cache)
+{
+	acquire_kspinlock(&MemFrameLists.mfllock);
+	struct FrameInfo *ptr_frame_info = remove_free_frame();
+	if (ptr_frame_info == NULL)
+	{
+		drain_frame_caches();
+		ptr_frame_info = remove_free_frame();
+	}
+	else if (frameCachesEnabled)
+	{
+		acquire_kspinlock(&cache->lock);
+		struct FrameInfo *ptr_fi;
+		while (cache->count < FRAME_CACHE_BATCH && (ptr_fi = remove_free_frame()) != NULL)
+			cache->frames[cache->count++] = ptr_fi;
+		release_kspinlock(&cache->lock);
+	}
+	release_kspinlock(&MemFrameLists.mfllock);
+	return ptr_frame_info;
+}
+
 //
 // Allocates a physical frame.
 // Does NOT set the contents of the physical frame to zero -
@@ -152,42 +471,92 @@ int allocate_frame(struct FrameInfo **ptr_frame_info)
 {
 	bool lock_already_held = holding_kspinlock(&MemFrameLists.mfllock);
 
+	if (frameCachesEnabled && !lock_already_held)
+	{
+		pushcli();
+		struct FrameCache* cache = my_frame_cache();
+		acquire_kspinlock(&cache->lock);
+		*ptr_frame_info = (cache->count > 0) ? cache->frames[--cache->count] : NULL;
+		release_kspinlock(&cache->lock);
+		if (*ptr_frame_info == NULL)
+			*ptr_frame_info = refill_frame_cache(cache);
+		popcli();
+		return (*ptr_frame_info == NULL) ? E_NO_MEM : 0;
+	}
+
 	if (!lock_already_held)
 	{
 		acquire_kspinlock(&MemFrameLists.mfllock);
 	}
 
-	*ptr_frame_info = LIST_FIRST(&MemFrameLists.free_frame_list);
-	int c = 0;
+	*ptr_frame_info = remove_free_frame();
+	if (*ptr_frame_info == NULL && frameCachesEnabled)
+	{
+		//the only free frames left may be in the per-CPU caches
+		drain_frame_caches();
+		*ptr_frame_info = remove_free_frame();
+	}
 
 	if (*ptr_frame_info == NULL)
 	{
 		// panic("ERROR: Kernel run out of memory... allocate_frame cannot find a free frame.\n");
+		if (!lock_already_held)
+		{
+			release_kspinlock(&MemFrameLists.mfllock);
+		}
 		return E_NO_MEM;
 	}
 
-	LIST_REMOVE(&MemFrameLists.free_frame_list,*ptr_frame_info);
+	if (!lock_already_held)
+	{
+		release_kspinlock(&MemFrameLists.mfllock);
+	}
 
-	/******************* PAGE BUFFERING CODE *******************
-	 ***********************************************************/
+	return 0;
+}
 
-	if((*ptr_frame_info)->isBuffered)
+//
+// Allocates "num_of_frames" physical frames at once (i.e. taking the frame lists lock once)
+// and appends them to the given list (linked by their prev_next_info).
+// Like allocate_frame(), the frames are NOT zeroed and their references are NOT incremented.
+//
+// RETURNS
+//   0 -- on success
+//   E_NO_MEM -- if there're less free frames than requested (no frame is allocated)
+//
+int allocate_frames(struct FrameInfo_List *frames, uint32 num_of_frames)
+{
+	bool lock_already_held = holding_kspinlock(&MemFrameLists.mfllock);
+
+	if (!lock_already_held)
 	{
-		/*MUST UN-COMMENT THIS LINE*/
-		//pt_clear_page_table_entry((*ptr_frame_info)->proc->env_page_directory,(*ptr_frame_info)->va);
+		acquire_kspinlock(&MemFrameLists.mfllock);
 	}
 
-	/**********************************************************
-	 ***********************************************************/
-
-	initialize_frame_info(*ptr_frame_info);
+	int ret = E_NO_MEM;
+	uint32 num_of_listed_frames = LIST_SIZE(&MemFrameLists.free_frame_list) + LIST_SIZE(&MemFrameLists.zeroed_frame_list) + buddyNumOfFreeFrames;
+	if (num_of_listed_frames < num_of_frames && frameCachesEnabled)
+	{
+		//take back the frames of the per-CPU caches (they're counted as free) before failing
+		drain_frame_caches();
+		num_of_listed_frames = LIST_SIZE(&MemFrameLists.free_frame_list) + LIST_SIZE(&MemFrameLists.zeroed_frame_list) + buddyNumOfFreeFrames;
+	}
+	if (num_of_listed_frames >= num_of_frames)
+	{
+		for (uint32 i = 0; i < num_of_frames; i++)
+		{
+			//NOTE: LIST_INSERT_TAIL evaluates its element several times, so take the frame first
+			struct FrameInfo *ptr_frame_info = remove_free_frame();
+			LIST_INSERT_TAIL(frames, ptr_frame_info);
+		}
+		ret = 0;
+	}
 
 	if (!lock_already_held)
 	{
 		release_kspinlock(&MemFrameLists.mfllock);
 	}
-
-	return 0;
+	return ret;
 }
 
 //
@@ -198,6 +567,43 @@ void free_frame(struct FrameInfo *ptr_frame_info)
 {
 	bool lock_already_held = holding_kspinlock(&MemFrameLists.mfllock);
 
+	//forget its remaining (stale) mappings before clearing its info: the extra ones are kmalloc'ed,
+	//so they're freed here, outside the frame lists lock (the kernel heap takes it while holding its own)
+	assert(!lock_already_held || ptr_frame_info->other_mappings == NULL);
+	release_frame_mappings(ptr_frame_info);
+
+	if (frameCachesEnabled && !lock_already_held)
+	{
+		initialize_frame_info(ptr_frame_info);
+		pushcli();
+		struct FrameCache* cache = my_frame_cache();
+		struct FrameInfo* batch[FRAME_CACHE_BATCH];
+		uint32 num_of_flushed = 0;
+		acquire_kspinlock(&cache->lock);
+		bool cached = frameCachesEnabled;	//re-checked: they may have been switched off meanwhile
+		if (cached)
+		{
+			if (cache->count == FRAME_CACHE_SIZE)
+			{
+				while (num_of_flushed < FRAME_CACHE_BATCH)
+					batch[num_of_flushed++] = cache->frames[--cache->count];
+			}
+			cache->frames[cache->count++] = ptr_frame_info;
+		}
+		release_kspinlock(&cache->lock);
+		if (num_of_flushed > 0)
+		{
+			//flush a batch to the lists (mfllock is never taken while holding a cache lock)
+			acquire_kspinlock(&MemFrameLists.mfllock);
+			while (num_of_flushed > 0)
+				insert_free_frame(batch[--num_of_flushed]);
+			release_kspinlock(&MemFrameLists.mfllock);
+		}
+		popcli();
+		if (cached)
+			return;
+	}
+
 	if (!lock_already_held)
 	{
 		acquire_kspinlock(&MemFrameLists.mfllock);
@@ -207,7 +613,9 @@ void free_frame(struct FrameInfo *ptr_frame_info)
 		initialize_frame_info(ptr_frame_info);
 		/*=============================================================================*/
 		// Fill this function in
-		LIST_INSERT_HEAD(&MemFrameLists.free_frame_list, ptr_frame_info);
+		//(it's not buffered anymore, so MemFrameLists.num_of_free_buffered is unchanged)
+		//(a frame of the buddy zone goes back to it, merged with its free buddies)
+		insert_free_frame(ptr_frame_info);
 		//LOG_STATMENT(cprintf("FN # %d FREED",to_frame_number(ptr_frame_info)));
 	}
 	if (!lock_already_held)
@@ -226,6 +634,98 @@ void decrement_references(struct FrameInfo* ptr_frame_info)
 		free_frame(ptr_frame_info);
 }
 
+//=========================================
+// PRE-ZEROED FRAMES POOL:
+//=========================================
+//
+// Moves up to "num_of_frames" frames of the pre-zeroed pool to the given list (taking the frame
+// lists lock once). Like allocate_frame(), their references are NOT incremented.
+// RETURNS the number of moved frames (the caller allocates & zeroes the rest itself)
+//
+uint32 allocate_zeroed_frames(struct FrameInfo_List *frames, uint32 num_of_frames)
+{
+	//unlocked peek: not worth taking the lock if the pool is empty
+	if (LIST_SIZE(&MemFrameLists.zeroed_frame_list) == 0)
+		return 0;
+
+	bool lock_already_held = holding_kspinlock(&MemFrameLists.mfllock);
+	if (!lock_already_held)
+	{
+		acquire_kspinlock(&MemFrameLists.mfllock);
+	}
+	uint32 cnt = 0;
+	struct FrameInfo *ptr_frame_info;
+	while (cnt < num_of_frames && (ptr_frame_info = LIST_FIRST(&MemFrameLists.zeroed_frame_list)) != NULL)
+	{
+		LIST_REMOVE(&MemFrameLists.zeroed_frame_list, ptr_frame_info);
+		LIST_INSERT_TAIL(frames, ptr_frame_info);
+		cnt++;
+	}
+	if (!lock_already_held)
+	{
+		release_kspinlock(&MemFrameLists.mfllock);
+	}
+	return cnt;
+}
+
+//
+// Gives back ALL the frames of the given list to the pre-zeroed pool (taking the frame lists lock once).
+// They MUST be untouched frames taken by allocate_zeroed_frames() (e.g. on the rollback of a failed
+// allocation), so that their zeroing isn't lost by putting them on the free_frame_list.
+//
+void free_zeroed_frames(struct FrameInfo_List *frames)
+{
+	bool lock_already_held = holding_kspinlock(&MemFrameLists.mfllock);
+	if (!lock_already_held)
+	{
+		acquire_kspinlock(&MemFrameLists.mfllock);
+	}
+	struct FrameInfo *ptr_frame_info;
+	while ((ptr_frame_info = LIST_FIRST(frames)) != NULL)
+	{
+		LIST_REMOVE(frames, ptr_frame_info);
+		LIST_INSERT_HEAD(&MemFrameLists.zeroed_frame_list, ptr_frame_info);
+	}
+	if (!lock_already_held)
+	{
+		release_kspinlock(&MemFrameLists.mfllock);
+	}
+}
+
+//
+// Zero up to ZEROED_POOL_REFILL_BATCH free frames and move them to the pre-zeroed pool.
+// Called by fos_scheduler() when there's nothing to run. Each frame is zeroed through this CPU's
+// ZEROING_VA while holding the frame lists lock, so it's never seen out of both lists.
+//
+void refill_zeroed_frames()
+{
+	for (int i = 0; i < ZEROED_POOL_REFILL_BATCH; i++)
+	{
+		acquire_kspinlock(&MemFrameLists.mfllock);
+		if (LIST_SIZE(&MemFrameLists.zeroed_frame_list) >= ZEROED_POOL_SIZE
+			|| LIST_SIZE(&MemFrameLists.free_frame_list) == 0)
+		{
+			release_kspinlock(&MemFrameLists.mfllock);
+			return;
+		}
+		struct FrameInfo *ptr_frame_info = remove_free_frame();
+#if USE_KHEAP
+		uint32 va = ZEROING_VA(mycpu() - CPUS);
+		uint32 *ptr_page_table = NULL;
+		get_page_table(ptr_page_directory, va, &ptr_page_table);
+		ptr_page_table[PTX(va)] = CONSTRUCT_ENTRY(to_physical_address(ptr_frame_info), PERM_WRITEABLE | PERM_PRESENT);
+		invlpg((void*)va);
+		memset((void*)va, 0, PAGE_SIZE);
+		ptr_page_table[PTX(va)] = 0;
+		invlpg((void*)va);
+#else
+		memset(STATIC_KERNEL_VIRTUAL_ADDRESS(to_physical_address(ptr_frame_info)), 0, PAGE_SIZE);
+#endif
+		LIST_INSERT_HEAD(&MemFrameLists.zeroed_frame_list, ptr_frame_info);
+		release_kspinlock(&MemFrameLists.mfllock);
+	}
+}
+
 //
 // Stores address of page table entry in *ptr_page_table .
 // Stores 0 if there is no such entry or on error.
@@ -341,6 +841,162 @@ void __static_cpt(uint32 *ptr_directory, const uint32 virtual_address, uint32 **
 	memset(*ptr_page_table , 0, PAGE_SIZE);
 	tlbflush();
 }
+
+//=========================================
+// REVERSE MAP (FRAME -> (ENV, VA)):
+//=========================================
+//Each mapping done by map_frame()/loadtime_map_frame() is recorded in the frame, and removed by
+//unmap_frame(), so all the users of a shared frame are found in O(# mappers) (no page tables scan).
+//The 1st mapping is inline in FrameInfo (mapped_address = 0 means none), so a non-shared frame
+//costs nothing more. The extra ones are allocated from the kernel heap: the kernel heap pages are
+//never shared, so this never recurses into the kernel heap while it maps its own pages.
+
+//The env whose page directory is the given one (NULL for the kernel page directory)
+static struct Env* env_of_directory(uint32 *ptr_directory)
+{
+	if (ptr_directory == ptr_page_directory)
+		return NULL;
+	//the current env, or the last one found (e.g. the env being created/freed), covers most calls
+	static struct Env* last_env = NULL;
+	struct Env* cur_env = get_cpu_proc();
+	if (cur_env != NULL && cur_env->env_page_directory == ptr_directory)
+		return cur_env;
+	if (last_env != NULL && last_env->env_status != ENV_FREE && last_env->env_page_directory == ptr_directory)
+		return last_env;
+	for (int i = 0; i < NENV; i++)
+	{
+		if (envs[i].env_status != ENV_FREE && envs[i].env_page_directory == ptr_directory)
+		{
+			last_env = &envs[i];
+			return last_env;
+		}
+	}
+	return NULL;
+}
+
+static inline uint32* directory_of_env(struct Env *env)
+{
+	return (env == NULL) ? ptr_page_directory : env->env_page_directory;
+}
+
+//Record that the frame is mapped at va of the given env. Returns E_NO_MEM if it can't be recorded
+static int add_frame_mapping(struct FrameInfo *ptr_frame_info, struct Env *env, uint32 va)
+{
+	va = ROUNDDOWN(va, PAGE_SIZE);
+	if (ptr_frame_info->mapped_address == 0)
+	{
+		ptr_frame_info->mapper_env = env;
+		ptr_frame_info->mapped_address = va;
+		return 0;
+	}
+#if USE_KHEAP
+	struct FrameMapping *mapping = kmalloc(sizeof(struct FrameMapping));
+	if (mapping == NULL)
+		return E_NO_MEM;
+	mapping->env = env;
+	mapping->va = va;
+	mapping->next = ptr_frame_info->other_mappings;
+	ptr_frame_info->other_mappings = mapping;
+#endif
+	return 0;
+}
+
+//Forget the mapping of the frame at va of the given env (if recorded)
+static void remove_frame_mapping(struct FrameInfo *ptr_frame_info, struct Env *env, uint32 va)
+{
+	va = ROUNDDOWN(va, PAGE_SIZE);
+	struct FrameMapping *mapping;
+	if (ptr_frame_info->mapped_address == va && ptr_frame_info->mapper_env == env)
+	{
+		//the next mapping (if any) becomes the inline one
+		mapping = ptr_frame_info->other_mappings;
+		ptr_frame_info->mapper_env = (mapping == NULL) ? NULL : mapping->env;
+		ptr_frame_info->mapped_address = (mapping == NULL) ? 0 : mapping->va;
+		if (mapping != NULL)
+		{
+			ptr_frame_info->other_mappings = mapping->next;
+			kfree(mapping);
+		}
+		return;
+	}
+	for (struct FrameMapping **ptr_link = &ptr_frame_info->other_mappings; *ptr_link != NULL; ptr_link = &(*ptr_link)->next)
+	{
+		mapping = *ptr_link;
+		if (mapping->va == va && mapping->env == env)
+		{
+			*ptr_link = mapping->next;
+			kfree(mapping);
+			return;
+		}
+	}
+}
+
+//Forget ALL the recorded mappings of the frame (e.g. when it's freed by a path that doesn't unmap_frame() it)
+static void release_frame_mappings(struct FrameInfo *ptr_frame_info)
+{
+	struct FrameMapping *mapping = ptr_frame_info->other_mappings;
+	while (mapping != NULL)
+	{
+		struct FrameMapping *next = mapping->next;
+		kfree(mapping);
+		mapping = next;
+	}
+	ptr_frame_info->other_mappings = NULL;
+	ptr_frame_info->mapper_env = NULL;
+	ptr_frame_info->mapped_address = 0;
+}
+
+uint32 num_of_frame_mappings(struct FrameInfo *ptr_frame_info)
+{
+	if (ptr_frame_info->mapped_address == 0)
+		return 0;
+	uint32 count = 1;
+	for (struct FrameMapping *mapping = ptr_frame_info->other_mappings; mapping != NULL; mapping = mapping->next)
+		count++;
+	return count;
+}
+
+//The mapping of the frame at old_va is moved to new_va in the same page directory (e.g. by cut_paste_pages)
+void move_frame_mapping(struct FrameInfo *ptr_frame_info, uint32 *ptr_page_directory, uint32 old_va, uint32 new_va)
+{
+	struct Env *env = env_of_directory(ptr_page_directory);
+	if (ptr_frame_info->mapped_address == old_va && ptr_frame_info->mapper_env == env)
+	{
+		ptr_frame_info->mapped_address = new_va;
+		return;
+	}
+	for (struct FrameMapping *mapping = ptr_frame_info->other_mappings; mapping != NULL; mapping = mapping->next)
+	{
+		if (mapping->va == old_va && mapping->env == env)
+		{
+			mapping->va = new_va;
+			return;
+		}
+	}
+}
+
+//Unmap the frame from all the (env, va) that map it, in O(# mappers). It's freed after the last one
+//(unless it's still referenced by a mapping that isn't recorded, e.g. a page table/directory frame)
+//NOTE: only used by "tst frames rmap" for now; it's meant for the page replacement and the shared
+//objects teardown (free_share/delete_shared_object), which are still not implemented
+void unmap_frame_from_all(struct FrameInfo *ptr_frame_info)
+{
+	//keep it alive till the loop ends (the last unmap_frame() would free & clear it)
+	ptr_frame_info->references++;
+	while (ptr_frame_info->mapped_address != 0)
+	{
+		struct Env *env = ptr_frame_info->mapper_env;
+		uint32 va = ptr_frame_info->mapped_address;
+		uint32 *ptr_directory = directory_of_env(env);
+		uint32 *ptr_page_table;
+		if (get_frame_info(ptr_directory, va, &ptr_page_table) == ptr_frame_info)
+			unmap_frame(ptr_directory, va);
+		else
+			remove_frame_mapping(ptr_frame_info, env, va);	//stale record
+	}
+	decrement_references(ptr_frame_info);
+}
+
 //
 // Map the physical frame 'ptr_frame_info' at 'virtual_address'.
 // The permissions (the low 12 bits) of the page table
@@ -413,10 +1069,8 @@ int map_frame(uint32 *ptr_page_directory, struct FrameInfo *ptr_frame_info, uint
 	//If already mapped
 	if ((page_table_entry & PERM_PRESENT) == PERM_PRESENT)
 	{
-		//on this pa, then do nothing
+		//on this pa, then do nothing (it's already in the reverse map)
 		if (EXTRACT_ADDRESS(page_table_entry) == physical_address){
-			// MODIFICATION HERE
-			ptr_frame_info->mapped_address = ROUNDDOWN(virtual_address, PAGE_SIZE); // Update mapped_address
 			return 0;
 		}
 		//on another pa, then unmap it
@@ -424,9 +1078,11 @@ int map_frame(uint32 *ptr_page_directory, struct FrameInfo *ptr_frame_info, uint
 			unmap_frame(ptr_page_directory , virtual_address);
 	}
 
-	ptr_frame_info->references++;
 	// MODIFICATION HERE
-	ptr_frame_info->mapped_address = ROUNDDOWN(virtual_address, PAGE_SIZE); // Update mapped_address
+	// Record the mapping in the reverse map (its 1st mapping is the mapped_address used by kheap_virtual_address)
+	if (add_frame_mapping(ptr_frame_info, env_of_directory(ptr_page_directory), virtual_address) != 0)
+		return E_NO_MEM;
+	ptr_frame_info->references++;
 	/*********************************************************************************/
 	/*NEW'23 el7:)
 	 * map_frame(): KEEP THE VALUES OF THE AVAILABLE BITS*/
@@ -489,6 +1145,7 @@ void unmap_frame(uint32 *ptr_page_directory, uint32 virtual_address)
 	{
 		if (ptr_frame_info->isBuffered && !CHECK_IF_KERNEL_ADDRESS((uint32)virtual_address))
 			cprintf("WARNING: Freeing BUFFERED frame at va %x!!!\n", virtual_address) ;
+		remove_frame_mapping(ptr_frame_info, env_of_directory(ptr_page_directory), virtual_address);
 		decrement_references(ptr_frame_info);
 
 		/*********************************************************************************/
@@ -515,7 +1172,7 @@ void unmap_frame(uint32 *ptr_page_directory, uint32 virtual_address)
 //
 // RETURNS:
 //   0 on success
-//
+//   E_NO_MEM if the mapping can't be recorded in the reverse map (nothing is mapped)
 //
 int loadtime_map_frame(uint32 *ptr_page_directory, struct FrameInfo *ptr_frame_info, uint32 virtual_address, int perm)
 {
@@ -547,6 +1204,8 @@ int loadtime_map_frame(uint32 *ptr_page_directory, struct FrameInfo *ptr_frame_i
 #endif
 	}
 
+	if (add_frame_mapping(ptr_frame_info, env_of_directory(ptr_page_directory), virtual_address) != 0)
+		return E_NO_MEM;
 	ptr_frame_info->references++;
 	ptr_page_table[PTX(virtual_address)] = CONSTRUCT_ENTRY(physical_address , perm | PERM_PRESENT);
 
@@ -565,10 +1224,11 @@ int loadtime_map_frame(uint32 *ptr_page_directory, struct FrameInfo *ptr_frame_i
 
 
 
-// calculate_available_frames:
+// calculate_available_frames: O(1), from the sizes of the frame lists, the count of
+// buffered free frames (kept up to date by allocate_frame(s)/free_frame), the pre-zeroed pool,
+// the buddy zone & the per-CPU frame caches
 struct freeFramesCounters calculate_available_frames()
 {
-	struct FrameInfo *ptr;
 	uint32 totalFreeUnBuffered = 0 ;
 	uint32 totalFreeBuffered = 0 ;
 	uint32 totalModified = 0 ;
@@ -579,14 +1239,9 @@ struct freeFramesCounters calculate_available_frames()
 	}
 	{
 		//calculate the free frames from the free frame list
-
-		LIST_FOREACH(ptr, &MemFrameLists.free_frame_list)
-		{
-			if (ptr->isBuffered)
-				totalFreeBuffered++ ;
-			else
-				totalFreeUnBuffered++ ;
-		}
+		totalFreeBuffered = MemFrameLists.num_of_free_buffered ;
+		totalFreeUnBuffered = LIST_SIZE(&MemFrameLists.free_frame_list) - totalFreeBuffered
+				+ LIST_SIZE(&MemFrameLists.zeroed_frame_list) + buddyNumOfFreeFrames + num_of_cached_frames() ;
 
 		/*2023: UPDATE based on suggestion from T112 2023.Term1*/
 		totalModified= LIST_SIZE(&MemFrameLists.modified_frame_list);
@@ -40,6 +40,34 @@ uint32 memory_scarce_threshold_percentage;	// Memory remains plentiful till the
 #define DEFAULT_MEM_SCARCE_PERCENTAGE 25	// Default threshold % of free memory to indicate scarce MEM
 //***********************************
 
+//***********************************
+//Per-CPU caches of free frames in front of free_frame_list, so that most allocate_frame/free_frame
+//don't take MemFrameLists.mfllock. Only worth it with more than one CPU (like the kheap DA magazines),
+//so they're off by default with a single CPU (set_frame_caches() switches them at run time)
+#define USE_FRAME_CACHES	(NCPUS > 1)
+#define FRAME_CACHE_SIZE	32						//max cached free frames per CPU
+#define FRAME_CACHE_BATCH	(FRAME_CACHE_SIZE / 2)	//frames moved per refill/flush from/to free_frame_list
+//***********************************
+
+//***********************************
+//Pool of free frames zeroed while the CPU is idle (in fos_scheduler), so that allocations that need
+//a zeroed page (alloc_page/alloc_pages with set_to_zero) don't memset it on their critical path
+#define ZEROED_POOL_SIZE			64		//max pre-zeroed frames
+#define ZEROED_POOL_REFILL_BATCH	4		//max frames zeroed per idle iteration (to stay responsive)
+//Per-CPU page, just below the kernel heap, where a frame is mapped to be zeroed
+//(with USE_KHEAP, only [KERNEL_BASE, ptr_free_mem) is remapped so this page is otherwise unused;
+//asserted at boot in initialize_kernel_VM)
+#define ZEROING_VA(cpuIndx)			(KERNEL_HEAP_START - ((cpuIndx) + 1) * PAGE_SIZE)
+//***********************************
+
+//***********************************
+//Buddy allocator of physically contiguous frames: the top 1/BUDDY_ZONE_FRACTION of the physical memory
+//(aligned to its largest block) is kept in free blocks of 2^order frames, order = [0, BUDDY_MAX_ORDER].
+//Its frames are still used by allocate_frame() once free_frame_list & the pre-zeroed pool are empty.
+#define BUDDY_MAX_ORDER			10		//largest block = 2^10 frames (4 MB)
+#define BUDDY_ZONE_FRACTION		8
+//***********************************
+
 //***********************************
 /*DATA*/
 struct freeFramesCounters
@@ -47,15 +75,37 @@ struct freeFramesCounters
 	int freeBuffered, freeNotBuffered, modified;
 };
 
+//An extra (env, va) mapping of a shared frame (see FrameInfo.other_mappings)
+struct FrameMapping
+{
+	struct Env *env;				//NULL for the kernel page directory
+	uint32 va;
+	struct FrameMapping *next;
+};
+
 
 //***********************************
 /*FUNCTIONS*/
 
 //RUN TIME [USER SPACE]
 int allocate_frame(struct FrameInfo **ptr_frame_info);
+int allocate_frames(struct FrameInfo_List *frames, uint32 num_of_frames);
 void free_frame(struct FrameInfo *ptr_frame_info);
+void flush_frame_caches();		//give back the frames cached by ALL CPUs to the frame lists
+void set_frame_caches(bool enable);	//switch the per-CPU frame caches on/off (default: USE_FRAME_CACHES)
+bool get_frame_caches();
+uint32 num_of_cached_frames();
+uint32 allocate_zeroed_frames(struct FrameInfo_List *frames, uint32 num_of_frames);	//take up to "num_of_frames" pre-zeroed frames (returns # taken)
+void free_zeroed_frames(struct FrameInfo_List *frames);	//give back (unused) frames of allocate_zeroed_frames() to the pool
+void refill_zeroed_frames();	//zero a batch of free frames into the pool (called when the CPU is idle)
+int allocate_contiguous_frames(uint32 order, struct FrameInfo **ptr_frame_info);	//2^order physically contiguous frames from the buddy zone
+void free_contiguous_frames(struct FrameInfo *ptr_frame_info, uint32 order);		//give back a block of allocate_contiguous_frames()
+uint32 num_of_free_buddy_blocks(uint32 order);
 int	map_frame(uint32 *ptr_page_directory, struct FrameInfo *ptr_frame_info, uint32 virtual_address, int perm);
 void unmap_frame(uint32 *pgdir, uint32 virtual_address);
+void unmap_frame_from_all(struct FrameInfo *ptr_frame_info);		//unmap it from every (env, va) in its reverse map
+uint32 num_of_frame_mappings(struct FrameInfo *ptr_frame_info);
+void move_frame_mapping(struct FrameInfo *ptr_frame_info, uint32 *ptr_page_directory, uint32 old_va, uint32 new_va);
 int get_page_table(uint32 *ptr_page_directory, const uint32 virtual_address, uint32 **ptr_page_table);
 /*2016*/ void * create_page_table(uint32 *ptr_page_directory, const uint32 virtual_address);
 struct FrameInfo *get_frame_info(uint32 *ptr_page_directory, uint32 virtual_address, uint32 **ptr_page_table);
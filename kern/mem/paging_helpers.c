@@ -166,7 +166,7 @@ inline uint32 num_of_references(uint32 physical_address)
 //If the given user virtual address is mapped, do nothing.
 //Else:
 //	allocate a single frame and map it to a given virtual address with the given perms.
-//	if set_to_zero, initialize it by ZEROs
+//	if set_to_zero, initialize it by ZEROs (or take a frame of the pre-zeroed pool)
 //Return
 //	0 on success,
 //	1 if already mapped
@@ -183,22 +183,91 @@ inline int alloc_page(uint32* directory, uint32 va, uint32 perms, bool set_to_ze
 		return 1;
 	}
 	else {
-		int ret = allocate_frame(&ptr_fi);
-		if (ret == E_NO_MEM) {
-			return E_NO_MEM;
+		struct FrameInfo_List zeroed;
+		LIST_INIT(&zeroed);
+		bool is_zeroed = set_to_zero && allocate_zeroed_frames(&zeroed, 1) == 1;
+		int ret;
+		if (is_zeroed) {
+			ptr_fi = LIST_FIRST(&zeroed);
+		}
+		else {
+			ret = allocate_frame(&ptr_fi);
+			if (ret == E_NO_MEM) {
+				return E_NO_MEM;
+			}
 		}
 		ret = map_frame(directory, ptr_fi, va, perms);
 		if (ret == E_NO_MEM) {
 			free_frame(ptr_fi);
 			return E_NO_MEM;
 		}
-		if (set_to_zero) {
+		if (set_to_zero && !is_zeroed) {
 			memset((void*)va, 0, PAGE_SIZE);
 		}
 		return 0;
 	}
 }
 
+//===============================
+//4') ALLOCATE PAGES
+//===============================
+//Allocate "num_of_pages" frames and map them to the contiguous range starting at the given
+//page-aligned va (which MUST be unmapped) with the given perms. Unlike calling alloc_page() per page,
+//the frames are taken under a single lock of the frame lists and the PTEs of each page table are
+//filled in one pass (the table is looked up once).
+//The directory MUST be the kernel one: each new frame is recorded directly as its only (inline)
+//mapping in the reverse map, i.e. (mapper_env = NULL [kernel], mapped_address = va).
+//	if set_to_zero, initialize them by ZEROs (frames of the pre-zeroed pool are mapped first and not zeroed again)
+//Return
+//	0 on success,
+//  E_NO_MEM if no memory (nothing is allocated)
+inline int alloc_pages(uint32* directory, uint32 va, uint32 num_of_pages, uint32 perms, bool set_to_zero)
+{
+	assert(directory == ptr_page_directory);
+	struct FrameInfo_List frames;
+	LIST_INIT(&frames);
+	uint32 num_of_zeroed = set_to_zero ? allocate_zeroed_frames(&frames, num_of_pages) : 0;
+	if (allocate_frames(&frames, num_of_pages - num_of_zeroed) == E_NO_MEM)
+	{
+		//allocate_frames() adds nothing on failure, so the list holds the pre-zeroed frames only
+		free_zeroed_frames(&frames);
+		return E_NO_MEM;
+	}
+
+	uint32 end = va + num_of_pages * PAGE_SIZE;
+	while (va != end)
+	{
+		uint32* ptr_table;
+		if (get_page_table(directory, va, &ptr_table) == TABLE_NOT_EXIST)
+		{
+#if USE_KHEAP
+			ptr_table = create_page_table(directory, va);
+#else
+			__static_cpt(directory, va, &ptr_table);
+#endif
+		}
+		//end of the range covered by this table (0 for the last table of the address space)
+		uint32 table_end = ROUNDDOWN(va, PTSIZE) + PTSIZE;
+		if (table_end == 0 || table_end > end)
+			table_end = end;
+		for (; va != table_end; va += PAGE_SIZE)
+		{
+			struct FrameInfo* ptr_fi = LIST_FIRST(&frames);
+			LIST_REMOVE(&frames, ptr_fi);
+			ptr_fi->references = 1;
+			ptr_fi->mapper_env = NULL;
+			ptr_fi->mapped_address = va;
+			uint32 pte_available_bits = ptr_table[PTX(va)] & PERM_AVAILABLE;
+			ptr_table[PTX(va)] = CONSTRUCT_ENTRY(to_physical_address(ptr_fi), pte_available_bits | perms | PERM_PRESENT);
+			if (num_of_zeroed > 0)
+				num_of_zeroed--;
+			else if (set_to_zero)
+				memset((void*)va, 0, PAGE_SIZE);
+		}
+	}
+	return 0;
+}
+
 //===============================
 //5) ALLOCATE SHARED PAGE
 //===============================
@@ -18,6 +18,7 @@ inline uint32 virtual_to_physical(uint32* page_directory, uint32 va);
 inline uint32 physical_to_virtual(uint32* page_directory, uint32 physical_address);
 inline uint32 num_of_references(uint32 physical_address);
 inline int alloc_page(uint32* page_directory, uint32 va, uint32 perms, bool set_to_zero);
+inline int alloc_pages(uint32* page_directory, uint32 va, uint32 num_of_pages, uint32 perms, bool set_to_zero);
 inline int alloc_shared_page(uint32* page_dir1, uint32 va1,uint32* page_dir2, uint32 va2, uint32 perms);
 inline void del_page_table(uint32* page_dir, uint32 va);
 
@@ -30,6 +30,49 @@ inline struct WorkingSetElement* env_page_ws_list_create_element(struct Env* e,
 	wse->time_stamp = 0x00000000;
 	return wse;
 }
+//Create "n" WS elements for the "n" consecutive pages starting at the given virtual address
+//in one batch (i.e. one kmalloc_blocks() instead of "n" kmalloc()).
+//If failed to create them, kernel should panic()!
+void env_page_ws_list_create_elements(struct Env* e, uint32 virtual_address, uint32 n, struct WorkingSetElement* elements[])
+{
+	assert(virtual_address >= 0 && virtual_address + n * PAGE_SIZE <= USER_TOP);
+	if (kmalloc_blocks(sizeof(struct WorkingSetElement), n, (void**)elements) != n)
+	{
+		panic("can't create %d new WS elements", n);
+	}
+	uint32 va = ROUNDDOWN(virtual_address,PAGE_SIZE);
+	for (uint32 i = 0; i < n; i++, va += PAGE_SIZE)
+	{
+		elements[i]->virtual_address = va;
+		elements[i]->sweeps_counter = 0;
+		elements[i]->time_stamp = 0x00000000;
+	}
+}
+//Remove ALL elements of the page WS (page_WS_list, ActiveList & SecondList) and free them
+//in batches of ENV_PAGE_WS_BATCH (i.e. kfree_blocks() instead of one kfree() per element).
+//NOTE: the pages themselves are NOT unmapped here
+void env_page_ws_list_free_all(struct Env* e)
+{
+	struct WS_List* lists[] = {&(e->page_WS_list), &(e->ActiveList), &(e->SecondList)};
+	void* batch[ENV_PAGE_WS_BATCH];
+	uint32 n = 0;
+	for (int l = 0; l < 3; l++)
+	{
+		struct WorkingSetElement *wse;
+		while ((wse = LIST_FIRST(lists[l])) != NULL)
+		{
+			LIST_REMOVE(lists[l], wse);
+			batch[n++] = wse;
+			if (n == ENV_PAGE_WS_BATCH)
+			{
+				kfree_blocks(batch, n);
+				n = 0;
+			}
+		}
+	}
+	kfree_blocks(batch, n);
+	e->page_last_WS_element = NULL;
+}
 inline void env_page_ws_invalidate(struct Env* e, uint32 virtual_address)
 {
 	if (isPageReplacmentAlgorithmLRU(PG_REP_LRU_LISTS_APPROX))
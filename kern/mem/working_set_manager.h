@@ -17,6 +17,9 @@ inline void env_page_ws_invalidate(struct Env* e, uint32 virtual_address);
 #if USE_KHEAP
 /*2024*/
 inline struct WorkingSetElement* env_page_ws_list_create_element(struct Env* e, uint32 virtual_address);
+#define ENV_PAGE_WS_BATCH 32		//max # WS elements created/freed in one batch
+void env_page_ws_list_create_elements(struct Env* e, uint32 virtual_address, uint32 n, struct WorkingSetElement* elements[]);
+void env_page_ws_list_free_all(struct Env* e);
 #else
 inline uint32 env_page_ws_get_size(struct Env *e);
 inline void env_page_ws_set_entry(struct Env* e, uint32 entry_index, uint32 virtual_address);
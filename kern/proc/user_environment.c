@@ -500,7 +500,7 @@ void env_free(struct Env *e)
 
 	// [1] [NOT REQUIRED] [If BUFFERING is Enabled] Un-buffer any BUFFERED page belong to this environment from the free/modified lists
 	// [2] Free the pages in the PAGE working set from the main memory
-	// [3] free the PAGE working set itself from the main memory
+	// [3] free the PAGE working set itself from the main memory (see env_page_ws_list_free_all())
 	// [4] free the USER HEAP block allocator [if exists]
 	// [5] Free Shared variables [if any]
 	// [6] Free Semaphores [if any]
@@ -776,6 +776,11 @@ static int program_segment_alloc_map_copy_workingset(struct Env *e, struct Progr
 			|| strcmp(e->prog_name, "tia_slave3") == 0 || strcmp(e->prog_name, "tia_slave4") == 0))
 		remaining_ws_pages = remaining_ws_pages < 9 ? remaining_ws_pages:9;
 	/*==========================================================================================*/
+#if USE_KHEAP
+	//WS elements of the segment pages are created in batches (instead of one kmalloc() per page)
+	struct WorkingSetElement* wseBatch[ENV_PAGE_WS_BATCH];
+	uint32 numInBatch = 0, nextInBatch = 0;
+#endif
 	for (; iVA < end_vaddr && i<remaining_ws_pages; i++, iVA += PAGE_SIZE)
 	{
 		// Allocate a page
@@ -786,7 +791,14 @@ static int program_segment_alloc_map_copy_workingset(struct Env *e, struct Progr
 		LOG_STRING("segment page mapped");
 
 #if USE_KHEAP
-		struct WorkingSetElement* wse = env_page_ws_list_create_element(e, iVA);
+		if (nextInBatch == numInBatch)
+		{
+			uint32 numOfRemPages = MIN((end_vaddr - iVA) / PAGE_SIZE, remaining_ws_pages - i);
+			numInBatch = MIN(numOfRemPages, ENV_PAGE_WS_BATCH);
+			nextInBatch = 0;
+			env_page_ws_list_create_elements(e, iVA, numInBatch, wseBatch);
+		}
+		struct WorkingSetElement* wse = wseBatch[nextInBatch++];
 		wse->time_stamp = 0;
 		LIST_INSERT_TAIL(&(e->page_WS_list), wse);
 
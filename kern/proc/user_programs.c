@@ -117,6 +117,8 @@ struct UserProgramInfo userPrograms[] = {
 		{ "tstChanAllSlave", "Slave program of tst_chan_all", PTR_START_OF(tst_chan_all_slave)},
 		{ "tst_chan_one", "Tests sleep & wakeup ONE on a channel", PTR_START_OF(tst_chan_one_master)},
 		{ "tstChanOneSlave", "Slave program of tst_chan_one", PTR_START_OF(tst_chan_one_slave)},
+		{ "tst_kmalloc_wait", "Tests blocking in kmalloc_wait() till a kernel heap block is freed", PTR_START_OF(tst_kmalloc_wait_master)},
+		{ "tstKMallocWaitSlave", "Slave program of tst_kmalloc_wait", PTR_START_OF(tst_kmalloc_wait_slave)},
 		/********************************************/
 		{ "tst_sleeplock", "Tests the acquire & release of sleep lock", PTR_START_OF(tst_sleeplock_master)},
 		{ "tstSleepLockSlave", "Slave program of tst_sleeplock", PTR_START_OF(tst_sleeplock_slave)},
@@ -146,6 +146,8 @@ DECLARE_START_OF(tst_chan_all_master);
 DECLARE_START_OF(tst_chan_all_slave);
 DECLARE_START_OF(tst_chan_one_master);
 DECLARE_START_OF(tst_chan_one_slave);
+DECLARE_START_OF(tst_kmalloc_wait_master);
+DECLARE_START_OF(tst_kmalloc_wait_slave);
 /********************************************/
 DECLARE_START_OF(tst_sleeplock_master);
 DECLARE_START_OF(tst_sleeplock_slave);
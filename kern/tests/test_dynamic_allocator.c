@@ -17,20 +17,23 @@
 /***********************************************************************************************************************/
 #define Mega  (1024*1024)
 #define kilo (1024)
-#define numOfLevels (LOG2_MAX_SIZE - LOG2_MIN_SIZE + 1)
+#define numOfLevels DYN_ALLOC_NUM_OF_SIZES
 
 short* startVAsInit[DYN_ALLOC_MAX_BLOCK_SIZE + 1] ;
 short* endVAsInit[DYN_ALLOC_MAX_BLOCK_SIZE + 1] ;
 
 __inline__ uint8 IDX(uint32 size)
 {
-	size>>= LOG2_MIN_SIZE;
-	int index = 0;
-	while ((size>>=1) != 0)
-	{
-		index++;
-	}
-	return index;
+	return get_size_class(size);
+}
+
+//Block size of the level that follows the given one (doubled after the last level)
+uint32 next_level_size(uint32 size)
+{
+	int index = IDX(size);
+	if (index + 1 < numOfLevels)
+		return dynAllocBlockSizes[index + 1];
+	return size * 2;
 }
 
 int check_dynalloc_datastruct(uint32 curSize, uint32 numOfBlksAtCurSize)
@@ -71,23 +74,56 @@ int check_dynalloc_datastruct(uint32 curSize, uint32 numOfBlksAtCurSize)
 		return 0;
 	}
 
-	//[2] Check freeBlkLists
+	//[2] Check free block lists of the partial pages at this size
 	int index = IDX(curSize);
-	struct BlockElement_List *ptrList = &freeBlockLists[index];
-	int n = 0;
+	int n = 0, listSizes = 0, numOfPartialPages = 0;
+	struct PageInfoElement *ptrPI;
 	struct BlockElement *ptrBlk;
-	LIST_FOREACH(ptrBlk, ptrList)
+	for (int bin = 0; bin < DYN_ALLOC_FULLNESS_BINS; ++bin)
 	{
-		n++;
+		numOfPartialPages += LIST_SIZE(&partialPagesLists[index][bin]);
+		LIST_FOREACH(ptrPI, &partialPagesLists[index][bin])
+		{
+			//free blocks = freed blocks (in the page list) + untouched blocks (not split yet)
+			int numOfUntouchedBlks = PAGE_SIZE / curSize - ptrPI->num_of_carved_blocks;
+			listSizes += ptrPI->num_of_free_blocks;
+			n += numOfUntouchedBlks;
+			for (ptrBlk = ptrPI->free_blocks; ptrBlk != NULL; ptrBlk = ptrBlk->next)
+			{
+				n++;
+			}
+		}
 	}
-	if (LIST_SIZE(ptrList) != expectedNumOfFreeBlks || n != expectedNumOfFreeBlks)
+	if (listSizes != expectedNumOfFreeBlks || n != expectedNumOfFreeBlks || numOfPartialPages != expectedNumOfInCompletePages)
 	{
-		cprintf_colored(TEXT_TESTERR_CLR,"freeBlockLists[%d] is not updated correctly!", index);
+		cprintf_colored(TEXT_TESTERR_CLR,"partialPagesLists[%d] is not updated correctly!", index);
+		return 0;
+	}
+
+	//[3] Check full pages list
+	if (LIST_SIZE(&fullPagesLists[index]) != expectedNumOfCompletePages)
+	{
+		cprintf_colored(TEXT_TESTERR_CLR,"fullPagesLists[%d] is not updated correctly!", index);
 		return 0;
 	}
 	return 1;
 }
 
+//Total number of free blocks in all pages of the given level (size class)
+uint32 num_of_free_blocks_at_level(int level)
+{
+	uint32 n = 0;
+	struct PageInfoElement *ptrPI;
+	for (int bin = 0; bin < DYN_ALLOC_FULLNESS_BINS; ++bin)
+	{
+		LIST_FOREACH(ptrPI, &partialPagesLists[level][bin])
+		{
+			n += ptrPI->num_of_free_blocks;
+		}
+	}
+	return n;
+}
+
 
 extern uint32* ptr_page_directory;
 extern void unmap_frame(uint32 *ptr_page_directory, uint32 virtual_address);
@@ -148,15 +184,23 @@ void test_initialize_dynamic_allocator()
 	{
 		panic("DA freePagesList is not initialized correctly! one or more pages are not added correctly");
 	}
-	//Check#4: freeBlockLists
-	cprintf_colored(TEXT_cyan, "\nCheck#4: freeBlockLists \n");
-	int numOfSizes = LOG2_MAX_SIZE - LOG2_MIN_SIZE + 1;
+	//Check#4: partialPagesLists & fullPagesLists
+	cprintf_colored(TEXT_cyan, "\nCheck#4: partialPagesLists & fullPagesLists \n");
+	int numOfSizes = DYN_ALLOC_NUM_OF_SIZES;
 	for (int i = 0; i < numOfSizes; ++i)
 	{
-		struct BlockElement_List *ptrList = &freeBlockLists[i];
+		for (int bin = 0; bin < DYN_ALLOC_FULLNESS_BINS; ++bin)
+		{
+			struct PageInfoElement_List *ptrList = &partialPagesLists[i][bin];
+			if (LIST_SIZE(ptrList) || LIST_FIRST(ptrList) || LIST_LAST(ptrList))
+			{
+				panic("DA partialPagesLists[%d][%d] is not initialized correctly!", i, bin);
+			}
+		}
+		struct PageInfoElement_List *ptrList = &fullPagesLists[i];
 		if (LIST_SIZE(ptrList) || LIST_FIRST(ptrList) || LIST_LAST(ptrList))
 		{
-			panic("DA freeBlockLists[%d] is not initialized correctly!", i);
+			panic("DA fullPagesLists[%d] is not initialized correctly!", i);
 		}
 	}
 
@@ -179,7 +223,7 @@ int test_initial_alloc()
 
 	//Remove the current 1-to-1 mapping of the KERNEL HEAP area since the USE_KHEAP = 0 for this test
 	uint32 startDA = KERNEL_HEAP_START ;
-	uint32 sizeDA = 0x2AE000 ;
+	uint32 sizeDA = 0x2A0000 ;	//672 pages = exactly what scenario 1 consumes over all the size classes
 	uint32 endDA = KERNEL_HEAP_START + sizeDA ;
 	remove_current_mappings(startDA, endDA);
 	initialize_dynamic_allocator(startDA, endDA);
@@ -192,7 +236,7 @@ int test_initial_alloc()
 	//====================================================================//
 	/*INITIAL ALLOC Scenario 1: Allocate set of blocks for each possible block size (consume entire space)*/
 	cprintf_colored(TEXT_cyan, "\n1: Allocate set of blocks for each possible block size (consume entire space)\n\n") ;
-	int curSize = 1<<LOG2_MIN_SIZE ;
+	int curSize = DYN_ALLOC_MIN_BLOCK_SIZE ;
 	int numOfBlksAtCurSize = 0;
 	int maxNumOfBlksAtCurPage = PAGE_SIZE / curSize;
 	uint32 expectedVA = KERNEL_HEAP_START;
@@ -224,7 +268,7 @@ int test_initial_alloc()
 			if (is_correct)	eval += 5;
 			//Reinitialize
 			{
-				curSize <<= 1;
+				curSize = next_level_size(curSize);
 				expectedVA += PAGE_SIZE;
 				numOfBlksAtCurSize = 0;
 				maxNumOfBlksAtCurPage = PAGE_SIZE / curSize;
@@ -237,6 +281,8 @@ int test_initial_alloc()
 		}
 
 	}
+	//rescale to 60%
+	eval = eval * 60 / (5 * (3 + numOfLevels));
 
 	//====================================================================//
 	/*INITIAL ALLOC Scenario 2: Allocate blocks of same size that consume remaining free blocks at all levels*/
@@ -266,12 +312,13 @@ int test_initial_alloc()
 			prevAllocPages += numOfAllocBlks / expectedNumOfBlksPerPage;
 		}
 		size1 = size2 ;
-		size2 *= 2 ;
+		size2 = next_level_size(size2) ;
 		idx++;
 	}
 
 	//Allocate a number of blocks of same size to consume all the remaining free blocks
-	int blkSize = 1<<LOG2_MIN_SIZE ;
+	int blkSize = DYN_ALLOC_MIN_BLOCK_SIZE ;
+	int eval2 = 0, numOfLevelsWithRem = 0;
 	for (int i = 0; i < numOfLevels; ++i)
 	{
 		uint32 expectedVA = KERNEL_HEAP_START + expectedPageIndex[i] * PAGE_SIZE;
@@ -297,7 +344,7 @@ int test_initial_alloc()
 
 		if (numOfRemFreeBlks[i] > 0)
 		{
-			if (LIST_SIZE(&freeBlockLists[i]) != 0)
+			if (num_of_free_blocks_at_level(i) != 0)
 			{
 				is_correct = 0;
 				cprintf_colored(TEXT_TESTERR_CLR, "alloc_block test#5: WRONG! there's still free blocks at level %d while not expected to\n", i);
@@ -307,9 +354,13 @@ int test_initial_alloc()
 				is_correct = 0;
 				cprintf_colored(TEXT_TESTERR_CLR, "alloc_block test#6: WRONG! there's still free blocks at page %d while not expected to\n", expectedPageIndex[i]);
 			}
-			if (is_correct)	eval += 5;
+			if (is_correct)	eval2 += 5;
+			numOfLevelsWithRem++;
 		}
 	}
+	//rescale to 20%
+	if (numOfLevelsWithRem > 0)
+		eval += eval2 * 20 / (5 * numOfLevelsWithRem);
 
 	//====================================================================//
 	/*INITIAL ALLOC Scenario 3: Check stored data inside each allocated block*/
@@ -334,7 +385,7 @@ int test_initial_alloc()
 	cprintf_colored(TEXT_cyan, "\n4: Check allocated frames\n\n") ;
 	is_correct = 1;
 	int freeFramesAfter = sys_calculate_free_frames();
-	int expectedNumOfAllocPages = 686;
+	int expectedNumOfAllocPages = 672;	//= sizeDA / PAGE_SIZE (sum over the 15 size classes)
 	if (freeFramesBefore - freeFramesAfter != expectedNumOfAllocPages)
 	{
 		is_correct = 0;
@@ -385,7 +436,7 @@ void test_free_block()
 
 	//Remove the current 1-to-1 mapping of the KERNEL HEAP area since the USE_KHEAP = 0 for this test
 	uint32 startDA = KERNEL_HEAP_START ;
-	uint32 sizeDA = 0x2AE000 ;
+	uint32 sizeDA = 0x2A0000 ;
 	uint32 endDA = KERNEL_HEAP_START + sizeDA ;
 	remove_current_mappings(startDA, endDA);
 	initialize_dynamic_allocator(startDA, endDA);
@@ -398,7 +449,7 @@ void test_free_block()
 	//====================================================================//
 	/*INITIAL ALLOCATION: Allocate set of blocks for each possible block size (consume entire space)*/
 	cprintf_colored(TEXT_cyan, "\n1: Allocate set of blocks for each possible block size (consume entire space)\n\n") ;
-	int curSize = 1<<LOG2_MIN_SIZE ;
+	int curSize = DYN_ALLOC_MIN_BLOCK_SIZE ;
 	int numOfBlksAtCurSize = 0;
 	int maxNumOfBlksAtCurPage = PAGE_SIZE / curSize;
 	uint32 expectedVA = KERNEL_HEAP_START;
@@ -421,7 +472,7 @@ void test_free_block()
 			}
 			//Reinitialize
 			{
-				curSize <<= 1;
+				curSize = next_level_size(curSize);
 				expectedVA += PAGE_SIZE;
 				numOfBlksAtCurSize = 0;
 				maxNumOfBlksAtCurPage = PAGE_SIZE / curSize;
@@ -462,12 +513,12 @@ void test_free_block()
 			prevAllocPages += numOfAllocBlks[idx] / expectedNumOfBlksPerPage;
 		}
 		size1 = size2 ;
-		size2 *= 2 ;
+		size2 = next_level_size(size2) ;
 		idx++;
 	}
 
 	//At each level that consume ONLY 1 page, free all its blocks (except 1)
-	curSize = 1<<LOG2_MIN_SIZE ;
+	curSize = DYN_ALLOC_MIN_BLOCK_SIZE ;
 	maxNumOfBlksAtCurPage = PAGE_SIZE / curSize;
 	idx = 0;
 	int freeFramesAfter = 0, freeFramesBefore = sys_calculate_free_frames();
@@ -491,7 +542,7 @@ void test_free_block()
 			is_correct = 1;
 			//Reinitialize
 			{
-				curSize <<= 1;
+				curSize = next_level_size(curSize);
 				idx++ ;
 				maxNumOfBlksAtCurPage = PAGE_SIZE / curSize;
 			}
@@ -526,7 +577,7 @@ void test_free_block()
 	cprintf_colored(TEXT_cyan, "\n3: Remove remaining block in each block size that consume at most 1 page  [30%]"
 			"(Page should be freed)\n") ;
 	//At each level that consume ONLY 1 page, free its remaining block
-	curSize = 1<<LOG2_MIN_SIZE ;
+	curSize = DYN_ALLOC_MIN_BLOCK_SIZE ;
 	idx = 0;
 	while (curSize < nextSize)
 	{
@@ -567,19 +618,19 @@ void test_free_block()
 
 		//Move to next block size
 		{
-			curSize <<= 1;
+			curSize = next_level_size(curSize);
 			idx++ ;
 		}
 	}
-	//rescale to 60% instead of 80%
-	eval = eval * 60 / 80;
+	//rescale to 60%
+	eval = eval * 60 / (20 * nextIdx);
 
 
 	//====================================================================//
 	/*FREE: Remove all blocks for each of the remaining block sizes*/
 	cprintf_colored(TEXT_cyan, "\n4: Remove all blocks for each of the remaining block sizes  [20%]\n") ;
 	curSize = nextSize ;
-	int startSize = (nextSize>>1) + 1;
+	int startSize = dynAllocBlockSizes[nextIdx - 1] + 1;
 	idx = nextIdx;
 	is_correct = 1;
 	for (int s = startSize; s <= DYN_ALLOC_MAX_BLOCK_SIZE; ++s)
@@ -602,7 +653,7 @@ void test_free_block()
 			}
 			//Reinitialize
 			{
-				curSize <<= 1;
+				curSize = next_level_size(curSize);
 				idx++ ;
 			}
 		}
@@ -17,6 +17,8 @@ void test_alloc_block();
 void test_free_block();
 void test_realloc_block();
 int check_dynalloc_datastruct(void* va, void* expectedVA, uint32 expectedSize, uint8 expectedFlag);
+uint32 num_of_free_blocks_at_level(int level);
+uint32 next_level_size(uint32 size);
 
 
 #endif /* KERN_TESTS_TEST_DYNAMIC_ALLOCATOR_H_ */
@@ -0,0 +1,232 @@
+/*
+ * test_frames.c
+ *
+ *  Tests of the physical frames manager (kern/mem/memory_manager.c)
+ */
+
+#include "test_frames.h"
+
+#include <inc/queue.h>
+#include <inc/error.h>
+#include <inc/dynamic_allocator.h>
+#include "../mem/memory_manager.h"
+#include "../mem/kheap.h"
+
+extern uint32 sys_calculate_free_frames();
+extern struct Env* env_create(char* user_program_name, unsigned int page_WS_size, unsigned int LRU_second_list_size, unsigned int percent_WS_pages_to_remove);
+
+//=====================================
+// 1) TEST PER-CPU FRAME CACHES:
+//=====================================
+//They're forced on (even with a single CPU) for the test, then switched back to their previous state
+int test_frame_caches()
+{
+	bool oldEnabled = get_frame_caches();
+	set_frame_caches(1);
+
+	uint32 freeFramesBefore = sys_calculate_free_frames();
+	struct FrameInfo* ptr_fi = NULL;
+
+	//1 frame: taken from a refilled cache, given back to it
+	if (allocate_frame(&ptr_fi) != 0 || ptr_fi == NULL)
+		panic("[EVAL] #1 allocate_frame() failed.\n");
+	if (sys_calculate_free_frames() != freeFramesBefore - 1)
+		panic("[EVAL] #2 wrong # free frames after allocate_frame(). Expected = %d, Actual = %d\n", freeFramesBefore - 1, sys_calculate_free_frames());
+	if (num_of_cached_frames() == 0)
+		panic("[EVAL] #3 the frame cache is not refilled by allocate_frame().\n");
+	free_frame(ptr_fi);
+	if (sys_calculate_free_frames() != freeFramesBefore)
+		panic("[EVAL] #4 wrong # free frames after free_frame(). Expected = %d, Actual = %d\n", freeFramesBefore, sys_calculate_free_frames());
+
+	//more frees than the cache can hold: the extra ones are flushed to the lists in batches
+	struct FrameInfo* frames[2*FRAME_CACHE_SIZE];
+	for (int i = 0; i < 2*FRAME_CACHE_SIZE; i++)
+	{
+		if (allocate_frame(&frames[i]) != 0)
+			panic("[EVAL] #5 allocate_frame() failed.\n");
+	}
+	for (int i = 0; i < 2*FRAME_CACHE_SIZE; i++)
+		free_frame(frames[i]);
+	if (num_of_cached_frames() > FRAME_CACHE_SIZE * NCPUS)
+		panic("[EVAL] #6 the frame caches overflowed (%d cached frames).\n", num_of_cached_frames());
+	if (sys_calculate_free_frames() != freeFramesBefore)
+		panic("[EVAL] #7 wrong # free frames after flushing the cache. Expected = %d, Actual = %d\n", freeFramesBefore, sys_calculate_free_frames());
+
+	//ALL the frames reported free can be taken at once: the cached ones are drained before failing
+	uint32 numOfCached = num_of_cached_frames();
+	if (numOfCached == 0)
+		panic("[EVAL] #8 no frame is cached after free_frame().\n");
+	struct FrameInfo_List frames_list;
+	LIST_INIT(&frames_list);
+	if (allocate_frames(&frames_list, freeFramesBefore) != 0)
+		panic("[EVAL] #9 allocate_frames() of all the %d free frames failed while %d of them are cached.\n", freeFramesBefore, numOfCached);
+	if (num_of_cached_frames() != 0 || sys_calculate_free_frames() != 0)
+		panic("[EVAL] #10 frames are left free after allocating all of them (%d free, %d cached).\n", sys_calculate_free_frames(), num_of_cached_frames());
+	//... and the same for a single frame with all the lists empty
+	while ((ptr_fi = LIST_FIRST(&frames_list)) != NULL && num_of_cached_frames() < FRAME_CACHE_BATCH)
+	{
+		LIST_REMOVE(&frames_list, ptr_fi);
+		free_frame(ptr_fi);
+	}
+	acquire_kspinlock(&MemFrameLists.mfllock);
+	int ret = allocate_frame(&ptr_fi);
+	release_kspinlock(&MemFrameLists.mfllock);
+	if (ret != 0)
+		panic("[EVAL] #11 allocate_frame() failed while %d frames are cached.\n", num_of_cached_frames());
+	LIST_INSERT_TAIL(&frames_list, ptr_fi);
+	while ((ptr_fi = LIST_FIRST(&frames_list)) != NULL)
+	{
+		LIST_REMOVE(&frames_list, ptr_fi);
+		free_frame(ptr_fi);
+	}
+	if (sys_calculate_free_frames() != freeFramesBefore)
+		panic("[EVAL] #12 wrong # free frames after freeing all of them. Expected = %d, Actual = %d\n", freeFramesBefore, sys_calculate_free_frames());
+
+	//flushing (or switching them off) empties the caches of ALL CPUs without losing frames
+	flush_frame_caches();
+	if (num_of_cached_frames() != 0)
+		panic("[EVAL] #13 %d frames are still cached after flush_frame_caches().\n", num_of_cached_frames());
+	if (sys_calculate_free_frames() != freeFramesBefore)
+		panic("[EVAL] #14 wrong # free frames after flush_frame_caches(). Expected = %d, Actual = %d\n", freeFramesBefore, sys_calculate_free_frames());
+
+	set_frame_caches(oldEnabled);
+	if (!oldEnabled && num_of_cached_frames() != 0)
+		panic("[EVAL] #15 frames are still cached after switching the caches off.\n");
+
+	cprintf("Congratulations!! test frame caches completed successfully.\n");
+	return 0;
+}
+
+//=====================================
+// 2) TEST BUDDY ALLOCATOR:
+//=====================================
+//Allocate one block of each order, then give back the even orders at once (free_contiguous_frames)
+//and the odd ones frame by frame (free_frame), last frame first. Since the free blocks of the zone only
+//depend on its free frames, they must all merge back to the same blocks as before the test
+int test_buddy_allocator()
+{
+	uint32 freeFramesBefore = sys_calculate_free_frames();
+	uint32 freeBlocksBefore[BUDDY_MAX_ORDER + 1];
+	for (int order = 0; order <= BUDDY_MAX_ORDER; order++)
+		freeBlocksBefore[order] = num_of_free_buddy_blocks(order);
+	if (freeBlocksBefore[BUDDY_MAX_ORDER] == 0)
+		panic("[EVAL] #1 there's no free block of the max order in the buddy zone (memory too small or already in use).\n");
+
+	struct FrameInfo* blocks[BUDDY_MAX_ORDER + 1];
+	uint32 numOfAllocated = 0;
+	for (int order = 0; order <= BUDDY_MAX_ORDER; order++)
+	{
+		if (allocate_contiguous_frames(order, &blocks[order]) != 0)
+			panic("[EVAL] #2 allocate_contiguous_frames(%d) failed.\n", order);
+		uint32 fn = to_frame_number(blocks[order]);
+		if (fn % (1 << order) != 0)
+			panic("[EVAL] #3 block of order %d at frame %d is not aligned.\n", order, fn);
+		for (uint32 i = 0; i < (1 << order); i++)
+		{
+			struct FrameInfo* ptr_fi = &frames_info[fn + i];
+			if (ptr_fi->is_buddy_free || ptr_fi->references != 0)
+				panic("[EVAL] #4 frame %d of the block of order %d is not a newly allocated frame.\n", fn + i, order);
+		}
+		//no overlap with the blocks of the smaller orders
+		for (int prev = 0; prev < order; prev++)
+		{
+			uint32 prevFn = to_frame_number(blocks[prev]);
+			if (prevFn + (1 << prev) > fn && fn + (1 << order) > prevFn)
+				panic("[EVAL] #5 blocks of orders %d and %d overlap.\n", prev, order);
+		}
+		numOfAllocated += (1 << order);
+	}
+	struct FrameInfo* ptr_fi;
+	if (allocate_contiguous_frames(BUDDY_MAX_ORDER + 1, &ptr_fi) != E_NO_MEM)
+		panic("[EVAL] #6 allocate_contiguous_frames() of an order > BUDDY_MAX_ORDER is not rejected.\n");
+	if (sys_calculate_free_frames() != freeFramesBefore - numOfAllocated)
+		panic("[EVAL] #7 wrong # free frames after the allocations. Expected = %d, Actual = %d\n", freeFramesBefore - numOfAllocated, sys_calculate_free_frames());
+
+	for (int order = 0; order <= BUDDY_MAX_ORDER; order++)
+	{
+		if (order % 2 == 0)
+		{
+			free_contiguous_frames(blocks[order], order);
+		}
+		else
+		{
+			for (int i = (1 << order) - 1; i >= 0; i--)
+				free_frame(blocks[order] + i);
+		}
+	}
+	//free_frame() may have kept frames in this CPU's cache
+	flush_frame_caches();
+
+	if (sys_calculate_free_frames() != freeFramesBefore)
+		panic("[EVAL] #8 wrong # free frames after the frees. Expected = %d, Actual = %d\n", freeFramesBefore, sys_calculate_free_frames());
+	for (int order = 0; order <= BUDDY_MAX_ORDER; order++)
+	{
+		if (num_of_free_buddy_blocks(order) != freeBlocksBefore[order])
+			panic("[EVAL] #9 the free blocks are not merged back: %d free blocks of order %d instead of %d.\n", num_of_free_buddy_blocks(order), order, freeBlocksBefore[order]);
+	}
+
+	cprintf("Congratulations!! test buddy allocator completed successfully.\n");
+	return 0;
+}
+
+//=====================================
+// 3) TEST REVERSE MAP:
+//=====================================
+static uint32 num_of_used_da_blocks()
+{
+	struct DynAllocStats stats;
+	kheap_get_da_stats(&stats);
+	uint32 count = 0;
+	for (int i = 0; i < DYN_ALLOC_NUM_OF_SIZES; i++)
+		count += stats.num_of_used_blocks[i];
+	return count;
+}
+
+//Share one frame between two user page directories, then unmap it from both at once
+int test_reverse_map()
+{
+#if !USE_KHEAP
+	panic("MUST ENABLE KHEAP");	//the extra mappings are allocated from the kernel heap
+	return 0;
+#endif
+	char prog_name[50] = "fos_helloWorld";
+	struct Env* env1 = env_create(prog_name, 20, 10, 0);
+	struct Env* env2 = env_create(prog_name, 20, 10, 0);
+	uint32 va1 = 0x2800000, va2 = 0x2900000;
+	uint32 perms = PERM_USER | PERM_WRITEABLE;
+
+	struct FrameInfo* ptr_fi = NULL;
+	if (allocate_frame(&ptr_fi) != 0)
+		panic("[EVAL] #1 allocate_frame() failed.\n");
+	if (map_frame(env1->env_page_directory, ptr_fi, va1, perms) != 0 || map_frame(env2->env_page_directory, ptr_fi, va2, perms) != 0)
+		panic("[EVAL] #2 map_frame() failed.\n");
+
+	if (num_of_frame_mappings(ptr_fi) != 2)
+		panic("[EVAL] #3 wrong # mappings of the shared frame. Expected = 2, Actual = %d\n", num_of_frame_mappings(ptr_fi));
+	if (ptr_fi->references != 2 || ptr_fi->other_mappings == NULL)
+		panic("[EVAL] #4 the shared frame is not recorded correctly (references = %d).\n", ptr_fi->references);
+
+	uint32 freeFramesBefore = sys_calculate_free_frames();
+	uint32 usedBlocksBefore = num_of_used_da_blocks();
+	unmap_frame_from_all(ptr_fi);
+
+	uint32* ptr_table;
+	struct Env* envs_to_chk[2] = {env1, env2};
+	uint32 vas_to_chk[2] = {va1, va2};
+	for (int i = 0; i < 2; i++)
+	{
+		get_page_table(envs_to_chk[i]->env_page_directory, vas_to_chk[i], &ptr_table);
+		if (ptr_table == NULL || (ptr_table[PTX(vas_to_chk[i])] & ~PERM_AVAILABLE) != 0)
+			panic("[EVAL] #5 the PTE of va %x is not cleared by unmap_frame_from_all().\n", vas_to_chk[i]);
+	}
+	if (ptr_fi->references != 0 || num_of_frame_mappings(ptr_fi) != 0 || ptr_fi->other_mappings != NULL)
+		panic("[EVAL] #6 the frame is still referenced/recorded after unmap_frame_from_all() (references = %d).\n", ptr_fi->references);
+	if (sys_calculate_free_frames() != freeFramesBefore + 1)
+		panic("[EVAL] #7 the frame is not freed after its last mapping. Expected free frames = %d, Actual = %d\n", freeFramesBefore + 1, sys_calculate_free_frames());
+	//(with the DA magazines, the freed mapping record may be cached as a used block)
+	if (!KHEAP_USE_DA_MAGAZINES && num_of_used_da_blocks() != usedBlocksBefore - 1)
+		panic("[EVAL] #8 the extra mapping record is not freed. Expected used blocks = %d, Actual = %d\n", usedBlocksBefore - 1, num_of_used_da_blocks());
+
+	cprintf("Congratulations!! test reverse map completed successfully.\n");
+	return 0;
+}
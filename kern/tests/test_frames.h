@@ -0,0 +1,22 @@
+/*
+ * test_frames.h
+ *
+ *  Tests of the physical frames manager (kern/mem/memory_manager.c)
+ */
+
+#ifndef KERN_TESTS_TEST_FRAMES_H_
+#define KERN_TESTS_TEST_FRAMES_H_
+#ifndef FOS_KERNEL
+# error "This is a FOS kernel header; user programs should not #include it"
+#endif
+
+#include <inc/stdio.h>
+#include <inc/string.h>
+#include <inc/memlayout.h>
+#include <inc/assert.h>
+
+int test_frame_caches();
+int test_buddy_allocator();
+int test_reverse_map();
+
+#endif /* KERN_TESTS_TEST_FRAMES_H_ */
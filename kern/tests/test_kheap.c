@@ -6,6 +6,7 @@
 #include <kern/cpu/sched.h>
 #include <kern/disk/pagefile_manager.h>
 #include "../mem/kheap.h"
+#include "../mem/kheap_bst.h"
 #include "../mem/memory_manager.h"
 
 
@@ -27,6 +28,8 @@ extern uint32 sys_rcr2();
 extern int execute_command(char *command_string);
 extern char end_of_kernel[];
 extern int CB(uint32 *ptr_dir, uint32 va, int bn);
+extern uint32 num_of_free_blocks_at_level(int level);
+extern uint32 next_level_size(uint32 size);
 
 
 /*KMALLOC*/
@@ -464,7 +467,7 @@ int initial_page_allocations()
 }
 
 short* startBlockVAs[DYN_ALLOC_MAX_SIZE / DYN_ALLOC_MIN_BLOCK_SIZE] = {0} ;
-#define numOfLevels (LOG2_MAX_SIZE - LOG2_MIN_SIZE + 1)
+#define numOfLevels DYN_ALLOC_NUM_OF_SIZES
 int numOfAllocBlocksPerSize[numOfLevels] = {0};
 int numOfAllocPages = 0;
 
@@ -484,7 +487,7 @@ int initial_block_allocations()
 	cprintf_colored(TEXT_cyan, "\n	1.1: Check initial BLOCK allocations (two blocks should be allocated at start-up 16B & 8B)\n\n") ;
 	uint32 numOfRemain8 = PAGE_SIZE / 8 - 1;
 	uint32 numOfRemain16 = PAGE_SIZE / 16 - 1;
-	if (LIST_SIZE(&freeBlockLists[0]) != numOfRemain8 || LIST_SIZE(&freeBlockLists[1]) != numOfRemain16)
+	if (num_of_free_blocks_at_level(0) != numOfRemain8 || num_of_free_blocks_at_level(1) != numOfRemain16)
 	{
 		is_correct = 0;
 		cprintf_colored(TEXT_TESTERR_CLR, "initial allocation #1: unexpected list size! check boot-time allocation\n");
@@ -494,7 +497,7 @@ int initial_block_allocations()
 	//====================================================================//
 	/*2: Allocate set of blocks for each possible block size */
 	cprintf_colored(TEXT_cyan, "	1.2: Allocate set of blocks for each possible block size \n\n") ;
-	int curSize = 1<<LOG2_MIN_SIZE ;
+	int curSize = DYN_ALLOC_MIN_BLOCK_SIZE ;
 	int curIndex = 0;
 	int numOfBlksAtCurSize = 0;
 	int maxNumOfBlksAtCurPage = PAGE_SIZE / curSize;
@@ -533,7 +536,7 @@ int initial_block_allocations()
 
 			//Reinitialize
 			{
-				curSize <<= 1;
+				curSize = next_level_size(curSize);
 				curIndex++;
 				currentVA += PAGE_SIZE;
 				numOfAllocPages++;
@@ -551,7 +554,7 @@ int initial_block_allocations()
 	//====================================================================//
 	/*3: Check content of each block */
 	cprintf_colored(TEXT_cyan, "	1.3: Check content of each block \n\n") ;
-	curSize = 1<<LOG2_MIN_SIZE ;
+	curSize = DYN_ALLOC_MIN_BLOCK_SIZE ;
 	is_correct = 1;
 	for (int s = 1; s <= DYN_ALLOC_MAX_BLOCK_SIZE; ++s)
 	{
@@ -570,12 +573,15 @@ int initial_block_allocations()
 
 			//Reinitialize
 			{
-				curSize <<= 1;
+				curSize = next_level_size(curSize);
 				is_correct = 1;
 			}
 		}
 	}
 
+	//rescale steps 2 & 3 to 90%
+	eval = eval * 90 / (10 * numOfLevels);
+
 	//====================================================================//
 	/*4: Check number of allocated pages */
 	cprintf_colored(TEXT_cyan, "	1.4: Check number of allocated pages \n\n") ;
@@ -795,11 +801,11 @@ int test_kmalloc_CF_block()
 				expectedPageIndex[i] = 0;
 				prevAllocPages += numOfAllocBlks / expectedNumOfBlksPerPage;
 			}
-			curSize *= 2 ;
+			curSize = next_level_size(curSize) ;
 		}
 
 		//Allocate a number of blocks of same size to consume all the remaining free blocks
-		int blkSize = 1<<LOG2_MIN_SIZE ;
+		int blkSize = DYN_ALLOC_MIN_BLOCK_SIZE ;
 		for (int i = 0; i < numOfLevels; ++i)
 		{
 			uint32 expectedVA = KERNEL_HEAP_START + expectedPageIndex[i] * PAGE_SIZE;
@@ -824,7 +830,7 @@ int test_kmalloc_CF_block()
 
 			if (numOfRemFreeBlks[i] > 0)
 			{
-				if (LIST_SIZE(&freeBlockLists[i]) != 0)
+				if (num_of_free_blocks_at_level(i) != 0)
 				{
 					is_correct = 0;
 					cprintf_colored(TEXT_TESTERR_CLR, "Block Alloc #6.3: WRONG! there's still free blocks at level %d while not expected to\n", i);
@@ -1223,7 +1229,7 @@ int test_kfree_CF_block()
 	is_correct = 1;
 	{
 		//At each level that consume ONLY 1 page, free all its blocks (except 1)
-		curSize = 1<<LOG2_MIN_SIZE ;
+		curSize = DYN_ALLOC_MIN_BLOCK_SIZE ;
 		maxNumOfBlksAtCurPage = PAGE_SIZE / curSize;
 		idx = 0;
 		int freeFramesAfter = 0, freeFramesBefore = sys_calculate_free_frames();
@@ -1236,7 +1242,7 @@ int test_kfree_CF_block()
 			{
 				//Reinitialize
 				{
-					curSize <<= 1;
+					curSize = next_level_size(curSize);
 					idx++ ;
 					maxNumOfBlksAtCurPage = PAGE_SIZE / curSize;
 				}
@@ -1276,7 +1282,7 @@ int test_kfree_CF_block()
 	cprintf_colored(TEXT_cyan,"\n3. Allocate same blocks after free with diff. content (pages should NOT be allocated) [15%]\n");
 	is_correct = 1;
 	{
-		curSize = 1<<LOG2_MIN_SIZE ;
+		curSize = DYN_ALLOC_MIN_BLOCK_SIZE ;
 		idx = 0;
 		void *va;
 		int freeFramesAfter = 0, freeFramesBefore = sys_calculate_free_frames();
@@ -1287,7 +1293,7 @@ int test_kfree_CF_block()
 			{
 				//Reinitialize
 				{
-					curSize <<= 1;
+					curSize = next_level_size(curSize);
 					idx++ ;
 				}
 				continue;
@@ -1336,7 +1342,7 @@ int test_kfree_CF_block()
 			if (s == curSize)
 			{
 				//Reinitialize
-				curSize <<= 1;
+				curSize = next_level_size(curSize);
 				idx++ ;
 				maxNumOfBlksAtCurPage = PAGE_SIZE / curSize;
 				expectedNumOfRemovedPages++;
@@ -1383,7 +1389,7 @@ int test_kfree_CF_block()
 			if (s == curSize)
 			{
 				//Reinitialize
-				curSize <<= 1;
+				curSize = next_level_size(curSize);
 				idx++ ;
 			}
 
@@ -1404,7 +1410,7 @@ int test_kfree_CF_block()
 	cprintf_colored(TEXT_cyan,"\n6. Check content of all blocks [20%]\n");
 	is_correct = 1;
 	{
-		curSize = 1<<LOG2_MIN_SIZE ;
+		curSize = DYN_ALLOC_MIN_BLOCK_SIZE ;
 		idx = 0;
 		void *va;
 		int mult ;
@@ -1428,7 +1434,7 @@ int test_kfree_CF_block()
 
 			if (s == curSize)
 			{
-				curSize <<= 1;
+				curSize = next_level_size(curSize);
 				idx++ ;
 			}
 		}
@@ -1469,10 +1475,10 @@ int test_kfree_CF_block()
 				if (i == 0) expectedNumOfFreeBlocks = expectedNumOfFreeBlocks8;
 				if (i == 1) expectedNumOfFreeBlocks = expectedNumOfFreeBlocks16;
 
-				if (LIST_SIZE(&freeBlockLists[i]) != expectedNumOfFreeBlocks)
+				if (num_of_free_blocks_at_level(i) != expectedNumOfFreeBlocks)
 				{
 					is_correct = 0;
-					cprintf_colored(TEXT_TESTERR_CLR, "Free Block Alloc #7: WRONG! number of free blocks at level %d is not correct. Actual: %d, Expected: %d\n", i, LIST_SIZE(&freeBlockLists[i]), expectedNumOfFreeBlocks);
+					cprintf_colored(TEXT_TESTERR_CLR, "Free Block Alloc #7: WRONG! number of free blocks at level %d is not correct. Actual: %d, Expected: %d\n", i, num_of_free_blocks_at_level(i), expectedNumOfFreeBlocks);
 				}
 			}
 		}
@@ -2165,6 +2171,291 @@ int test_fast_CF()
 	panic("not implemented function");
 }
 
+/**********************************************************************************************/
+/****************************** PLACEMENT STRATEGIES BENCHMARK ********************************/
+/**********************************************************************************************/
+#define BENCH_NUM_OF_SLOTS 64		//max live page allocations at a time
+#define BENCH_NUM_OF_OPS 4000		//kmalloc/kfree calls per strategy
+#define BENCH_MAX_PAGES 16			//max pages per allocation
+
+static uint32 benchSeed ;
+static uint32 bench_rand()
+{
+	benchSeed = benchSeed * 1103515245 + 12345 ;
+	return (benchSeed >> 16) & 0x7FFF ;
+}
+
+//Runs the same random kmalloc/kfree sequence (page allocator only) with each placement strategy
+//and prints, for each: the avg cycles of kmalloc & kfree, the peak break and the external
+//fragmentation of the free space left by the live allocations (1 - largest free chunk / free pages)
+int test_kheap_placement_bench()
+{
+	cprintf_colored(TEXT_yellow,"==============================================\n");
+	cprintf_colored(TEXT_yellow,"MAKE SURE to have a FRESH RUN for this test\n(i.e. don't run any program/test before it)\n");
+	cprintf_colored(TEXT_yellow,"==============================================\n");
+
+	uint32 strategies[] = {KHP_PLACE_CONTALLOC, KHP_PLACE_FIRSTFIT, KHP_PLACE_NEXTFIT, KHP_PLACE_BESTFIT, KHP_PLACE_WORSTFIT, KHP_PLACE_CUSTOMFIT};
+	char* names[] = {"CONT ALLOC", "FIRST FIT", "NEXT FIT", "BEST FIT", "WORST FIT", "CUSTOM FIT"};
+	int numOfStrategies = sizeof(strategies) / sizeof(strategies[0]);
+
+	uint32 oldStrategy = get_kheap_strategy();
+	uint32 breakBefore = kheapPageAllocBreak ;
+	void* ptrs[BENCH_NUM_OF_SLOTS];
+	uint32 pages[BENCH_NUM_OF_SLOTS];
+	int eval = 0;
+	int correct = 1;
+	int released = 1;
+
+	cprintf_colored(TEXT_cyan,"\n%d random kmalloc/kfree of 1..%d pages, at most %d live allocations\n", BENCH_NUM_OF_OPS, BENCH_MAX_PAGES, BENCH_NUM_OF_SLOTS);
+	cprintf("%12s | kmalloc cyc | kfree cyc | failed | peak break (pages) | free pages | largest free | ext. frag\n", "strategy");
+	for (int s = 0; s < numOfStrategies; ++s)
+	{
+		set_kheap_strategy(strategies[s]);
+		benchSeed = 1 ;
+		memset(ptrs, 0, sizeof(ptrs));
+		uint32 allocCycles = 0, numOfAllocs = 0, freeCycles = 0, numOfFrees = 0, numOfFailed = 0;
+		uint32 peakBreak = kheapPageAllocBreak ;
+		for (int op = 0; op < BENCH_NUM_OF_OPS; ++op)
+		{
+			int i = bench_rand() % BENCH_NUM_OF_SLOTS ;
+			if (ptrs[i] == NULL)
+			{
+				pages[i] = bench_rand() % BENCH_MAX_PAGES + 1 ;
+				uint64 t0 = read_tsc();
+				ptrs[i] = kmalloc(pages[i] * PAGE_SIZE);
+				allocCycles += (uint32)(read_tsc() - t0);
+				numOfAllocs++ ;
+				if (ptrs[i] == NULL)
+				{
+					numOfFailed++ ;
+					continue;
+				}
+				uint32 va = (uint32)ptrs[i];
+				if (va < kheapPageAllocStart || va + pages[i] * PAGE_SIZE > kheapPageAllocBreak)
+				{
+					if (correct) cprintf_colored(TEXT_TESTERR_CLR,"%s: kmalloc returned %x which is outside the page allocator\n", names[s], va);
+					correct = 0;
+				}
+				//tag the first & last words to catch overlapped allocations
+				*(uint32*)va = i ;
+				*(uint32*)(va + pages[i] * PAGE_SIZE - sizeof(uint32)) = i ;
+				peakBreak = MAX(peakBreak, kheapPageAllocBreak);
+			}
+			else
+			{
+				uint32 va = (uint32)ptrs[i];
+				if (*(uint32*)va != i || *(uint32*)(va + pages[i] * PAGE_SIZE - sizeof(uint32)) != i)
+				{
+					if (correct) cprintf_colored(TEXT_TESTERR_CLR,"%s: allocation at %x is overwritten (overlapped allocations)\n", names[s], va);
+					correct = 0;
+				}
+				uint64 t0 = read_tsc();
+				kfree(ptrs[i]);
+				freeCycles += (uint32)(read_tsc() - t0);
+				numOfFrees++ ;
+				ptrs[i] = NULL ;
+			}
+		}
+
+		//fragmentation of the free space between the live allocations
+		uint32 freePages = 0, largestFree = 0;
+		for (struct PageChunkNode* node = bst_first_by_addr(); node != NULL; node = bst_next_by_addr(node))
+		{
+			freePages += node->num_of_pages ;
+			largestFree = MAX(largestFree, node->num_of_pages);
+		}
+		for (int b = 0; b < KHEAP_NUM_OF_PAGE_BINS; ++b)
+		{
+			struct PageChunkNode* run;
+			LIST_FOREACH(run, &kheap_page_bins[b])
+			{
+				freePages += run->num_of_pages ;
+				largestFree = MAX(largestFree, run->num_of_pages);
+			}
+		}
+		uint32 frag = (freePages == 0) ? 0 : 100 - (largestFree * 100) / freePages ;
+		cprintf("%12s | %11d | %9d | %6d | %18d | %10d | %12d | %8d%%\n", names[s],
+				numOfAllocs ? allocCycles / numOfAllocs : 0, numOfFrees ? freeCycles / numOfFrees : 0, numOfFailed,
+				(peakBreak - kheapPageAllocStart) / PAGE_SIZE, freePages, largestFree, frag);
+		if (kheap_check() != 0)
+		{
+			if (correct) cprintf_colored(TEXT_TESTERR_CLR,"%s: kheap integrity check failed (see above)\n", names[s]);
+			correct = 0;
+		}
+
+		for (int i = 0; i < BENCH_NUM_OF_SLOTS; ++i)
+		{
+			if (ptrs[i] != NULL)
+				kfree(ptrs[i]);
+		}
+		if (kheapPageAllocBreak != breakBefore)
+		{
+			if (released) cprintf_colored(TEXT_TESTERR_CLR,"%s: BREAK is not restored after freeing everything! Expected = %x, Actual = %x\n", names[s], breakBefore, kheapPageAllocBreak);
+			released = 0;
+		}
+	}
+	set_kheap_strategy(oldStrategy);
+
+	if (correct) eval += 50;
+	if (released) eval += 50;
+	cprintf_colored(TEXT_light_green,"\nTest kheap placement benchmark Completed. Evaluation = %d%\n", eval);
+	return 0;
+}
+
+
+
+
+/**********************************************************************************************/
+/************************************* LAZY KMALLOC *******************************************/
+/**********************************************************************************************/
+#define LAZY_NUM_OF_PAGES 8			//pages of the lazy buffer
+#define LAZY_TOUCHED_PAGE 3			//page touched before the krealloc()s (kept by the shrink)
+#define LAZY_CUT_PAGE 6				//page touched then cut by the shrink
+#define LAZY_SHRUNK_PAGES 5
+#define LAZY_GROWN_PAGES 12
+#define LAZY_MAX_BLOCKERS 64
+
+//PTE of the given kernel heap va (0 if it has no page table)
+static uint32 kheap_pte(uint32 va)
+{
+	uint32* ptr_table = NULL;
+	get_page_table(ptr_page_directory, va, &ptr_table);
+	return (ptr_table == NULL) ? 0 : ptr_table[PTX(va)];
+}
+
+//1 if each page of [va, va + num_of_pages) is lazy & not touched yet (mark = 1) or is neither marked nor mapped (mark = 0)
+static int check_lazy_pages(uint32 va, uint32 num_of_pages, int mark)
+{
+	for (uint32 i = 0; i < num_of_pages; i++)
+	{
+		uint32 pte = kheap_pte(va + i * PAGE_SIZE);
+		if ((pte & PERM_PRESENT) != 0 || ((pte & PERM_KHLAZY) != 0) != mark)
+			return 0;
+	}
+	return 1;
+}
+
+//1 if the whole page at va reads as zeros (the 1st read of a lazy page faults it in)
+static int check_zero_page(uint32 va)
+{
+	for (uint32* ptr = (uint32*)va; ptr < (uint32*)(va + PAGE_SIZE); ptr++)
+	{
+		if (*(volatile uint32*)ptr != 0)
+			return 0;
+	}
+	return 1;
+}
+
+//kmalloc_lazy() of LAZY_NUM_OF_PAGES pages: only its 1st page is mapped at first, each other page
+//is mapped (zeroed) by kheap_lazy_fault() on its 1st touch. Then krealloc() shrinks it in place
+//(the marks of the cut pages are cleared) and grows it with a move (the marks move with the pages)
+int test_kmalloc_lazy()
+{
+	cprintf_colored(TEXT_yellow,"==============================================\n");
+	cprintf_colored(TEXT_yellow,"MAKE SURE to have a FRESH RUN for this test\n(i.e. don't run any program/test before it)\n");
+	cprintf_colored(TEXT_yellow,"==============================================\n");
+
+	int eval = 0;
+	int correct = 1;
+	uint32 freeFramesBefore = sys_calculate_free_frames();
+
+	//1. allocate: only the 1st page gets a frame
+	cprintf_colored(TEXT_cyan,"\n1. kmalloc_lazy() of %d pages\n", LAZY_NUM_OF_PAGES);
+	uint32 va = (uint32)kmalloc_lazy(LAZY_NUM_OF_PAGES * PAGE_SIZE);
+	if (va == 0 || va < kheapPageAllocStart || va + LAZY_NUM_OF_PAGES * PAGE_SIZE > kheapPageAllocBreak)
+		panic("kmalloc_lazy() returned %x which is outside the page allocator", va);
+	if (freeFramesBefore - sys_calculate_free_frames() != 1)
+	{ correct = 0; cprintf_colored(TEXT_TESTERR_CLR,"Wrong # allocated frames. Expected = 1, Actual = %d\n", freeFramesBefore - sys_calculate_free_frames()); }
+	if ((kheap_pte(va) & (PERM_PRESENT | PERM_KHLAZY)) != (PERM_PRESENT | PERM_KHLAZY) || !check_lazy_pages(va + PAGE_SIZE, LAZY_NUM_OF_PAGES - 1, 1))
+	{ correct = 0; cprintf_colored(TEXT_TESTERR_CLR,"The pages of the lazy buffer are not marked (or are mapped)\n"); }
+	if (correct) eval += 20;
+
+	//2. touch: each 1st touch maps 1 zeroed page
+	cprintf_colored(TEXT_cyan,"\n2. touch pages %d & %d\n", LAZY_TOUCHED_PAGE, LAZY_CUT_PAGE);
+	correct = 1;
+	uint32 freeFrames = sys_calculate_free_frames();
+	if (!check_zero_page(va + LAZY_TOUCHED_PAGE * PAGE_SIZE))
+	{ correct = 0; cprintf_colored(TEXT_TESTERR_CLR,"The touched lazy page is not zeroed\n"); }
+	if (freeFrames - sys_calculate_free_frames() != 1)
+	{ correct = 0; cprintf_colored(TEXT_TESTERR_CLR,"Wrong # allocated frames after the 1st touch. Expected = 1, Actual = %d\n", freeFrames - sys_calculate_free_frames()); }
+	if ((kheap_pte(va + LAZY_TOUCHED_PAGE * PAGE_SIZE) & PERM_PRESENT) == 0 || !check_lazy_pages(va + (LAZY_TOUCHED_PAGE + 1) * PAGE_SIZE, LAZY_NUM_OF_PAGES - LAZY_TOUCHED_PAGE - 1, 1))
+	{ correct = 0; cprintf_colored(TEXT_TESTERR_CLR,"Only the touched page shall be mapped\n"); }
+	*(uint32*)va = 0xCAFEBABE;
+	*(uint32*)(va + LAZY_TOUCHED_PAGE * PAGE_SIZE + PAGE_SIZE - sizeof(uint32)) = 0xDEADBEEF;
+	*(uint32*)(va + LAZY_CUT_PAGE * PAGE_SIZE) = 0x1234;
+	if (freeFrames - sys_calculate_free_frames() != 2)
+	{ correct = 0; cprintf_colored(TEXT_TESTERR_CLR,"Wrong # allocated frames after the 2nd touch. Expected = 2, Actual = %d\n", freeFrames - sys_calculate_free_frames()); }
+	if (correct) eval += 20;
+
+	//3. shrink in place: the touched page that is cut is freed and the marks of the cut pages are cleared
+	cprintf_colored(TEXT_cyan,"\n3. krealloc() shrink to %d pages\n", LAZY_SHRUNK_PAGES);
+	correct = 1;
+	freeFrames = sys_calculate_free_frames();
+	if ((uint32)krealloc((void*)va, LAZY_SHRUNK_PAGES * PAGE_SIZE) != va)
+		panic("krealloc() didn't shrink the lazy buffer in place");
+	if (sys_calculate_free_frames() - freeFrames != 1)
+	{ correct = 0; cprintf_colored(TEXT_TESTERR_CLR,"Wrong # freed frames by the shrink. Expected = 1, Actual = %d\n", sys_calculate_free_frames() - freeFrames); }
+	if (!check_lazy_pages(va + LAZY_SHRUNK_PAGES * PAGE_SIZE, LAZY_NUM_OF_PAGES - LAZY_SHRUNK_PAGES, 0))
+	{ correct = 0; cprintf_colored(TEXT_TESTERR_CLR,"The cut pages are still marked (or mapped)\n"); }
+	if (!check_lazy_pages(va + (LAZY_TOUCHED_PAGE + 1) * PAGE_SIZE, LAZY_SHRUNK_PAGES - LAZY_TOUCHED_PAGE - 1, 1)
+		|| *(uint32*)(va + LAZY_TOUCHED_PAGE * PAGE_SIZE + PAGE_SIZE - sizeof(uint32)) != 0xDEADBEEF)
+	{ correct = 0; cprintf_colored(TEXT_TESTERR_CLR,"The kept pages are changed by the shrink\n"); }
+	if (correct) eval += 20;
+
+	//4. grow with a move: take the page right after the buffer so it can't grow in place
+	cprintf_colored(TEXT_cyan,"\n4. krealloc() grow to %d pages (moved)\n", LAZY_GROWN_PAGES);
+	correct = 1;
+	void* blockers[LAZY_MAX_BLOCKERS];
+	int numOfBlockers = 0;
+	while (numOfBlockers < LAZY_MAX_BLOCKERS && (kheap_pte(va + LAZY_SHRUNK_PAGES * PAGE_SIZE) & PERM_PRESENT) == 0)
+	{
+		blockers[numOfBlockers] = kmalloc(PAGE_SIZE);
+		if (blockers[numOfBlockers++] == NULL)
+			break;
+	}
+	if ((kheap_pte(va + LAZY_SHRUNK_PAGES * PAGE_SIZE) & PERM_PRESENT) == 0)
+		panic("can't allocate the page after the lazy buffer (the kernel heap is too fragmented, run it on a FRESH kernel)");
+	freeFrames = sys_calculate_free_frames();
+	uint32 new_va = (uint32)krealloc((void*)va, LAZY_GROWN_PAGES * PAGE_SIZE);
+	if (new_va == 0 || new_va == va)
+		panic("krealloc() didn't move the lazy buffer (returned %x)", new_va);
+	if (freeFrames - sys_calculate_free_frames() != LAZY_GROWN_PAGES - LAZY_SHRUNK_PAGES)
+	{ correct = 0; cprintf_colored(TEXT_TESTERR_CLR,"Wrong # allocated frames by the grow. Expected = %d, Actual = %d\n", LAZY_GROWN_PAGES - LAZY_SHRUNK_PAGES, freeFrames - sys_calculate_free_frames()); }
+	if (!check_lazy_pages(va, LAZY_SHRUNK_PAGES, 0))
+	{ correct = 0; cprintf_colored(TEXT_TESTERR_CLR,"The old range is still marked (or mapped) after the move\n"); }
+	if (!check_lazy_pages(new_va + PAGE_SIZE, LAZY_TOUCHED_PAGE - 1, 1)
+		|| !check_lazy_pages(new_va + (LAZY_TOUCHED_PAGE + 1) * PAGE_SIZE, LAZY_SHRUNK_PAGES - LAZY_TOUCHED_PAGE - 1, 1))
+	{ correct = 0; cprintf_colored(TEXT_TESTERR_CLR,"The marks of the untouched pages are not moved\n"); }
+	for (uint32 i = LAZY_SHRUNK_PAGES; i < LAZY_GROWN_PAGES; i++)
+	{
+		if ((kheap_pte(new_va + i * PAGE_SIZE) & (PERM_PRESENT | PERM_KHLAZY)) != PERM_PRESENT)
+		{ correct = 0; cprintf_colored(TEXT_TESTERR_CLR,"The extra page #%d is not mapped (or is marked lazy)\n", i); break; }
+	}
+	if (*(uint32*)new_va != 0xCAFEBABE || *(uint32*)(new_va + LAZY_TOUCHED_PAGE * PAGE_SIZE + PAGE_SIZE - sizeof(uint32)) != 0xDEADBEEF)
+	{ correct = 0; cprintf_colored(TEXT_TESTERR_CLR,"The content of the touched pages is not moved\n"); }
+	//a moved untouched page is still mapped (zeroed) on its 1st touch
+	freeFrames = sys_calculate_free_frames();
+	if (!check_zero_page(new_va + PAGE_SIZE) || freeFrames - sys_calculate_free_frames() != 1)
+	{ correct = 0; cprintf_colored(TEXT_TESTERR_CLR,"A moved untouched page is not faulted in (zeroed) on its 1st touch\n"); }
+	if (correct) eval += 20;
+
+	//5. free: all the frames are back & the kernel heap is consistent
+	cprintf_colored(TEXT_cyan,"\n5. kfree()\n");
+	correct = 1;
+	kfree((void*)new_va);
+	for (int i = 0; i < numOfBlockers; i++)
+		kfree(blockers[i]);
+	if (sys_calculate_free_frames() != freeFramesBefore)
+	{ correct = 0; cprintf_colored(TEXT_TESTERR_CLR,"Frames are not freed. Expected free frames = %d, Actual = %d\n", freeFramesBefore, sys_calculate_free_frames()); }
+	if (!check_lazy_pages(new_va, LAZY_GROWN_PAGES, 0))
+	{ correct = 0; cprintf_colored(TEXT_TESTERR_CLR,"The freed range is still marked (or mapped)\n"); }
+	if (kheap_check() != 0)
+	{ correct = 0; cprintf_colored(TEXT_TESTERR_CLR,"kheap integrity check failed (see above)\n"); }
+	if (correct) eval += 20;
+
+	cprintf_colored(TEXT_light_green,"\nTest kmalloc_lazy Completed. Evaluation = %d%\n", eval);
+	return 0;
+}
 
 
 
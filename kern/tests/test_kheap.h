@@ -22,6 +22,8 @@
  int test_kheap_phys_addr();
  int test_kheap_virt_addr();
  int test_fast_page_alloc();
+ int test_kheap_placement_bench();
+ int test_kmalloc_lazy();
  int test_three_creation_functions();
  int test_ksbrk();
 
@@ -19,6 +19,7 @@
 #include "../tests/test_commands.h"
 #include "../tests/test_dynamic_allocator.h"
 #include "../tests/test_scheduler.h"
+#include "../tests/test_frames.h"
 
 struct Test tests[] = {
 		{"3functions", "Env Load: test the creation of new dir, tables and pages WS", tst_three_creation_functions},
@@ -39,6 +40,7 @@ struct Test tests[] = {
 		{"pg", "Test paging manipulation for a specific page", tst_paging_manipulation},
 		{"chunks","Test chunk manipulations", tst_chunks },
 		{"kheap", "Test KHEAP functions", tst_kheap},
+		{"frames", "Test the physical frames manager", tst_frames},
 
 };
 
@@ -368,6 +370,31 @@ int tst_paging_manipulation(int number_of_arguments, char **arguments)
 	return 0;
 }
 
+int tst_frames(int number_of_arguments, char **arguments)
+{
+	if (number_of_arguments != 2)
+	{
+		cprintf("Invalid number of arguments! USAGE: tst frames <testname>\n") ;
+		return 0;
+	}
+	// Per-CPU frame caches Test: tst frames caches
+	if(strcmp(arguments[1], "caches") == 0)
+	{
+		test_frame_caches();
+	}
+	// Buddy allocator Test: tst frames buddy
+	else if(strcmp(arguments[1], "buddy") == 0)
+	{
+		test_buddy_allocator();
+	}
+	// Reverse map Test: tst frames rmap
+	else if(strcmp(arguments[1], "rmap") == 0)
+	{
+		test_reverse_map();
+	}
+	return 0;
+}
+
 int tst_kheap(int number_of_arguments, char **arguments)
 {
 #if !USE_KHEAP
@@ -405,6 +432,16 @@ int tst_kheap(int number_of_arguments, char **arguments)
 		cprintf("Invalid number of arguments! USAGE: tst kheap <Strategy> krealloc <both or blk or page>\n") ;
 		return 0;
 	}
+	else if (strcmp(arguments[2], "bench") == 0 && number_of_arguments != 3)
+	{
+		cprintf("Invalid number of arguments! USAGE: tst kheap <Strategy> bench\n") ;
+		return 0;
+	}
+	else if (strcmp(arguments[2], "lazy") == 0 && number_of_arguments != 3)
+	{
+		cprintf("Invalid number of arguments! USAGE: tst kheap <Strategy> lazy\n") ;
+		return 0;
+	}
 
 	// Specify Test Type [if any]
 	uint32 testType = 0;
@@ -493,6 +530,19 @@ int tst_kheap(int number_of_arguments, char **arguments)
 		test_krealloc(testType);
 		return 0;
 	}
+	// Test 6-bench: tst kheap <Strategy> bench (compares ALL placement strategies)
+	// <Strategy> IS NEGLECTED
+	else if(strcmp(arguments[2], "bench") == 0)
+	{
+		test_kheap_placement_bench();
+		return 0;
+	}
+	// Test 7-lazy: tst kheap <Strategy> lazy (kmalloc_lazy, its page faults & krealloc of it)
+	else if(strcmp(arguments[2], "lazy") == 0)
+	{
+		test_kmalloc_lazy();
+		return 0;
+	}
 	/*	// Test 6-sbr: tst kheap FF sbrk
 	else if (strcmp(arguments[2], "sbrk") == 0)
 	{
@@ -50,6 +50,7 @@ int tst_dyn_alloc(int number_of_arguments, char **arguments);
 int tst_paging_manipulation(int number_of_arguments, char **arguments);
 int tst_chunks(int number_of_arguments, char **arguments);
 int tst_kheap(int number_of_arguments, char **arguments);
+int tst_frames(int number_of_arguments, char **arguments);
 
 /*2024*/
 int tst_priorityRR(int number_of_arguments, char **arguments);
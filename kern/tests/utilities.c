@@ -15,6 +15,7 @@
 #include <kern/cpu/cpu.h>
 #include <kern/disk/pagefile_manager.h>
 #include <kern/mem/memory_manager.h>
+#include <kern/mem/kheap.h>
 #include "../cons/console.h"
 
 #include <kern/trap/fault_handler.h>
@@ -148,6 +149,13 @@ void fixedPt2Str(fixed_point_t f, int num_dec_digits, char* output)
 int __firstTimeSleep = 1;
 struct Channel __tstchan__ ;
 struct kspinlock __tstchan_lk__;
+//Kernel heap blocks held by the kmalloc_wait() test (linked through their 1st word)
+extern struct Channel kheap_da_chan;
+struct kspinlock __tstDABlocks_lk__;
+void* __tstDABlocks__ = NULL;
+uint32 __tstDABlockSize__ = 0;
+//filling the kernel block allocator stops before the free frames get below this margin
+#define __TST_DA_FILL_FRAMES_MARGIN__	1024
 int __firstTimeSleepLock = 1;
 struct sleeplock __tstslplk__;
 
@@ -296,6 +304,64 @@ void sys_utilities(char* utilityName, int value)
 		int* numOfProcesses = (int*) value ;
 		*numOfProcesses = LIST_SIZE(&__tstchan__.queue);
 	}
+	else if (strcmp(utilityName, "__KHeapFillDA__") == 0)
+	{
+		//allocate blocks of the max size till the kernel block allocator is full (up to 32MB of frames),
+		//but stop while there're still __TST_DA_FILL_FRAMES_MARGIN__ free frames (on a small RAM,
+		//the kernel would fail to allocate its own pages/tables first). Sets *isFull to 1 if it's full
+		int* isFull = (int*) value ;
+		init_kspinlock(&__tstDABlocks_lk__, "Test DA Blocks Lock");
+		__tstDABlockSize__ = DYN_ALLOC_MAX_BLOCK_SIZE;
+		*isFull = 0;
+		while (1)
+		{
+			struct freeFramesCounters counters = calculate_available_frames();
+			if (counters.freeBuffered + counters.freeNotBuffered < __TST_DA_FILL_FRAMES_MARGIN__)
+				break;
+			void* blk = kmalloc(__tstDABlockSize__);
+			if (blk == NULL)
+			{
+				*isFull = 1;
+				break;
+			}
+			*(void**)blk = __tstDABlocks__;
+			__tstDABlocks__ = blk;
+		}
+	}
+	else if (strcmp(utilityName, "__KMallocWait__") == 0)
+	{
+		//blocks the calling process till a block of the filled size is freed
+		int* success = (int*) value ;
+		void* blk = kmalloc_wait(__tstDABlockSize__);
+		*success = (blk != NULL);
+		if (blk != NULL)
+		{
+			acquire_kspinlock(&__tstDABlocks_lk__);
+			*(void**)blk = __tstDABlocks__;
+			__tstDABlocks__ = blk;
+			release_kspinlock(&__tstDABlocks_lk__);
+		}
+	}
+	else if (strcmp(utilityName, "__KFreeOneDABlock__") == 0 || strcmp(utilityName, "__KHeapReleaseDA__") == 0)
+	{
+		bool freeAll = (strcmp(utilityName, "__KHeapReleaseDA__") == 0);
+		do
+		{
+			acquire_kspinlock(&__tstDABlocks_lk__);
+			void* blk = __tstDABlocks__;
+			if (blk != NULL)
+				__tstDABlocks__ = *(void**)blk;
+			release_kspinlock(&__tstDABlocks_lk__);
+			if (blk == NULL)
+				break;
+			kfree(blk);
+		} while (freeAll);
+	}
+	else if (strcmp(utilityName, "__GetKHeapDAWaitersCnt__") == 0)
+	{
+		int* numOfProcesses = (int*) value ;
+		*numOfProcesses = LIST_SIZE(&kheap_da_chan.queue);
+	}
 	else if (strcmp(utilityName, "__GetReadyQueueSize__") == 0)
 	{
 		int* numOfProcesses = (int*) value ;
@@ -511,7 +577,10 @@ void scarce_memory()
 	int fflSize = 0;
 	acquire_kspinlock(&MemFrameLists.mfllock);
 	{
-		fflSize = LIST_SIZE(&MemFrameLists.free_frame_list);
+		//the frames cached by the CPUs are counted as free: take them back to the lists first
+		flush_frame_caches();
+		struct freeFramesCounters counters = calculate_available_frames();
+		fflSize = counters.freeBuffered + counters.freeNotBuffered;
 
 		uint32 size_of_already_allocated = number_of_frames - fflSize ;
 		uint32 size_tobe_allocated = total_size_tobe_allocated - size_of_already_allocated;
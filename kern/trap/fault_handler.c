@@ -131,6 +131,9 @@ void fault_handler(struct Trapframe *tf)
 #if USE_KHEAP
 		if (fault_va >= KERNEL_HEAP_MAX)
 			panic("Kernel: heap overflow exception!");
+		//1st touch of a page reserved by kmalloc_lazy()
+		if (kheap_lazy_fault(fault_va))
+			return;
 #endif
 	}
 	//2017: Check stack underflow for User
@@ -16,6 +16,8 @@
 #include <kern/disk/pagefile_manager.h>
 #include <kern/mem/memory_manager.h>
 #include <kern/mem/shared_memory_manager.h>
+#include <kern/mem/kheap.h>
+#include <inc/dynamic_allocator.h>
 #include <kern/tests/utilities.h>
 #include <kern/tests/test_working_set.h>
 
@@ -243,6 +245,10 @@ int sys_calculate_pages_tobe_removed_ready_exit(uint32 WS_or_MEMORY_flag)
 
 void sys_scarce_memory(void)
 {
+#if USE_KHEAP
+	//memory is about to be scarce: first give back what the kernel heap keeps cached
+	kheap_reclaim();
+#endif
 	scarce_memory();
 }
 
@@ -251,7 +257,10 @@ void sys_clearFFL()
 	int size;
 	acquire_kspinlock(&MemFrameLists.mfllock);
 	{
-		size = LIST_SIZE(&MemFrameLists.free_frame_list) ;
+		//the frames cached by the CPUs are counted as free: take them back to the lists to be cleared too
+		flush_frame_caches();
+		struct freeFramesCounters counters = calculate_available_frames();
+		size = counters.freeBuffered + counters.freeNotBuffered ;
 		struct FrameInfo* ptr_tmp_FI ;
 		for (int i = 0; i < size ; i++)
 		{
@@ -503,6 +512,23 @@ int sys_get_optimal_num_faults()
 	return 0;
 }
 
+//Copy the statistics of the kernel heap block allocator into the given user struct
+void sys_get_kheap_da_stats(struct DynAllocStats* stats)
+{
+	uint32 va = (uint32)stats;
+	if (va == 0 || va >= USER_TOP || va + sizeof(struct DynAllocStats) > USER_TOP
+		|| va + sizeof(struct DynAllocStats) < va)
+	{
+		cprintf("\nsys_get_kheap_da_stats(): ILLEGAL ADDRESS! Process will be terminated...\n");
+		env_exit();
+	}
+	//take the snapshot on the kernel stack, then copy it to the user after the DA lock is released
+	//(a fault on the user page must not happen while kheap_da_lock is held)
+	struct DynAllocStats snapshot;
+	kheap_get_da_stats(&snapshot);
+	*stats = snapshot;
+}
+
 //====================================
 /*******************************/
 /* ETC... SYSTEM CALLS */
@@ -706,6 +732,10 @@ uint32 syscall(uint32 syscallno, uint32 a1, uint32 a2, uint32 a3, uint32 a4, uin
 	case SYS_get_optimal_num_faults:
 		return sys_get_optimal_num_faults();
 
+	case SYS_get_kheap_da_stats:
+		sys_get_kheap_da_stats((struct DynAllocStats*)a1);
+		return 0;
+
 	case NSYSCALLS:
 		return 	-E_INVAL;
 		break;
@@ -5,6 +5,7 @@
  *      Author: HP
  */
 #include <inc/assert.h>
+#include <inc/stdio.h>
 #include <inc/string.h>
 #include "../inc/dynamic_allocator.h"
 
@@ -35,6 +36,34 @@ __inline__ struct PageInfoElement * to_page_info(uint32 va)
 	return &pageBlockInfoArr[idxInPageInfoArr];
 }
 
+//==================================
+// [3] GET SIZE CLASS OF A SIZE:
+//==================================
+const uint16 dynAllocBlockSizes[DYN_ALLOC_NUM_OF_SIZES] =
+{
+	8, 16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048
+};
+
+//sizeClassLookup[(size + 7) >> 3] = index of the smallest size class that fits "size"
+//(i.e. index in dynAllocBlockSizes[], partialPagesLists[] & fullPagesLists[]). Filled once in initialize_dynamic_allocator()
+static uint8 sizeClassLookup[(DYN_ALLOC_MAX_BLOCK_SIZE >> LOG2_MIN_SIZE) + 1];
+
+static void init_size_class_lookup()
+{
+	int idx = 0;
+	for (uint32 units = 0; units <= (DYN_ALLOC_MAX_BLOCK_SIZE >> LOG2_MIN_SIZE); units++)
+	{
+		while (dynAllocBlockSizes[idx] < (units << LOG2_MIN_SIZE))
+			idx++;
+		sizeClassLookup[units] = idx;
+	}
+}
+
+__inline__ int get_size_class(uint32 size)
+{
+	return sizeClassLookup[(size + DYN_ALLOC_MIN_BLOCK_SIZE - 1) >> LOG2_MIN_SIZE];
+}
+
 //==================================================================================//
 //============================ REQUIRED FUNCTIONS ==================================//
 //==================================================================================//
@@ -70,16 +99,27 @@ void initialize_dynamic_allocator(uint32 daStart, uint32 daEnd)
     for(int i=0;i<page_info_array_size;i++){
         pageBlockInfoArr[i].block_size = 0;
         pageBlockInfoArr[i].num_of_free_blocks = 0;
+        pageBlockInfoArr[i].num_of_carved_blocks = 0;
+        pageBlockInfoArr[i].free_blocks = NULL;
         LIST_INSERT_TAIL(&freePagesList, &pageBlockInfoArr[i]);
     }
 
 
-    //initializing free block list
-    int free_blk_list_array_size = LOG2_MAX_SIZE - LOG2_MIN_SIZE + 1;
+    //initializing size class lookup table
+    init_size_class_lookup();
+
+    //initializing partial & full page lists of each size
+    int free_blk_list_array_size = DYN_ALLOC_NUM_OF_SIZES;
     for(int i=0;i<free_blk_list_array_size;i++){
-        LIST_INIT(&freeBlockLists[i]);
+        for(int bin=0;bin<DYN_ALLOC_FULLNESS_BINS;bin++){
+            LIST_INIT(&partialPagesLists[i][bin]);
+        }
+        LIST_INIT(&fullPagesLists[i]);
     }
 
+    //resetting statistics
+    memset(&dynAllocStats, 0, sizeof(dynAllocStats));
+
     //Comment the following line
     //panic("initialize_dynamic_allocator() Not implemented yet");
 
@@ -92,9 +132,7 @@ __inline__ uint32 get_block_size(void *va)
 {
 	//TODO: [PROJECT'25.GM#1] DYNAMIC ALLOCATOR - #2 get_block_size
 	//Your code is here
-	int nowPage = ((unsigned int) va - dynAllocStart) / PAGE_SIZE;
-	int nowData = pageBlockInfoArr[nowPage].block_size;
-	return nowData;
+	return to_page_info((uint32)va)->block_size;
 	//Comment the following line
 	//panic("get_block_size() Not implemented yet");
 }
@@ -102,6 +140,114 @@ __inline__ uint32 get_block_size(void *va)
 //===========================
 // 3) ALLOCATE BLOCK:
 //===========================
+//The list that a used page of size class "idx" belongs to according to its fullness:
+//	fullPagesLists[idx] if it has no free blocks, else
+//	partialPagesLists[idx][bin], where higher bins hold fuller pages
+static struct PageInfoElement_List *page_list_of(struct PageInfoElement *p, int idx)
+{
+	if (p->num_of_free_blocks == 0)
+		return &fullPagesLists[idx];
+	uint32 totBlks = PAGE_SIZE / p->block_size;
+	uint32 usedBlks = totBlks - p->num_of_free_blocks;
+	return &partialPagesLists[idx][usedBlks * DYN_ALLOC_FULLNESS_BINS / totBlks];
+}
+
+//Most-full partial page of size class "idx" (NULL if none)
+static struct PageInfoElement *most_full_partial_page(int idx)
+{
+	for (int bin = DYN_ALLOC_FULLNESS_BINS - 1; bin >= 0; bin--)
+	{
+		if (LIST_SIZE(&partialPagesLists[idx][bin]) > 0)
+			return LIST_FIRST(&partialPagesLists[idx][bin]);
+	}
+	return NULL;
+}
+
+//Take up to "n" free blocks of the given page (of size class "idx") for requests of "size" bytes each: previously freed ones first,
+//then the next untouched ones (pages are split lazily), and move the page (once) to the list of its new fullness.
+//Returns the number of blocks taken (stored in out[])
+static uint32 alloc_blocks_from_page(struct PageInfoElement *p, int idx, uint32 size, uint32 n, void* out[])
+{
+	struct PageInfoElement_List *oldList = page_list_of(p, idx);
+
+	uint32 cnt = 0;
+	for (; cnt < n && p->num_of_free_blocks > 0; cnt++)
+	{
+		struct BlockElement *b = p->free_blocks;
+		if (b != NULL)
+		{
+			//reuse a freed block first
+			p->free_blocks = b->next;
+		}
+		else
+		{
+			//carve the next untouched block of the page
+			b = (struct BlockElement*) (to_page_va(p) + p->num_of_carved_blocks * p->block_size);
+			p->num_of_carved_blocks++;
+		}
+		p->num_of_free_blocks -= 1;
+		out[cnt] = b;
+	}
+
+	dynAllocStats.num_of_allocs[idx] += cnt;
+	dynAllocStats.num_of_used_blocks[idx] += cnt;
+	dynAllocStats.wasted_bytes[idx] += (p->block_size - size) * cnt;
+
+	struct PageInfoElement_List *newList = page_list_of(p, idx);
+	if (newList != oldList)
+	{
+		LIST_REMOVE(oldList, p);
+		LIST_INSERT_HEAD(newList, p);
+	}
+	return cnt;
+}
+
+//Page to allocate the next block(s) of size class "idx" from (NULL if none). Its size class is set in *pIdx:
+//	1. the most-full partial page of this size, else
+//	2. a free page (allocated from the kernel and set to this size), else
+//	3. the most-full partial page of the next larger size that has one
+static struct PageInfoElement *page_to_alloc_from(int idx, int *pIdx)
+{
+	//case one: a partial page of this size exists (take the most-full one)
+	struct PageInfoElement *p = most_full_partial_page(idx);
+	*pIdx = idx;
+	if (p != NULL)
+		return p;
+
+	if (LIST_SIZE(&freePagesList) > 0) {
+		//case two: a free page exists
+		uint32 blkSize = dynAllocBlockSizes[idx];
+		p = LIST_FIRST(&freePagesList);
+		uint32 va = to_page_va(p);
+		get_page((void*) va);
+		LIST_REMOVE(&freePagesList, p);
+		p->block_size = blkSize;
+		p->num_of_free_blocks = (PAGE_SIZE / blkSize);
+
+		//don't split the page up-front: its blocks are carved on demand (see num_of_carved_blocks)
+		p->free_blocks = NULL;
+		p->num_of_carved_blocks = 0;
+		LIST_INSERT_HEAD(page_list_of(p, idx), p);
+
+		dynAllocStats.num_of_pages[idx]++;
+		if (++dynAllocStats.num_of_pages_in_use > dynAllocStats.peak_num_of_pages_in_use)
+			dynAllocStats.peak_num_of_pages_in_use = dynAllocStats.num_of_pages_in_use;
+
+		return p;
+	}
+	//case three: allocate block from next list
+	int sz = DYN_ALLOC_NUM_OF_SIZES;
+	for (int i = idx + 1; i < sz; i++) {
+		p = most_full_partial_page(i);
+		if (p != NULL)
+		{
+			*pIdx = i;
+			return p;
+		}
+	}
+	return NULL;
+}
+
 void *alloc_block(uint32 size)
 {
     //==================================================================================
@@ -114,59 +260,23 @@ void *alloc_block(uint32 size)
     //==================================================================================
     //TODO: [PROJECT'25.GM#1] DYNAMIC ALLOCATOR - #3 alloc_block
     //Your code is here
-	uint32 req = size;
-	uint32 nearestPof2 = 8;
-	int idx = 0;
-	if (req == 0)
+	if (size == 0)
 		return NULL;
 
-	//find nearest power of 2
-	while (nearestPof2 < req) {
-		nearestPof2 *= 2;
-		idx++;
-	}
+	//find size class (smallest block size that fits)
+	int idx = get_size_class(size);
 
-	if (LIST_SIZE(&freeBlockLists[idx]) > 0) {
-		//case one: a free block exists
-		struct BlockElement *b = LIST_FIRST(&freeBlockLists[idx]);
-		struct PageInfoElement *p = to_page_info((uint32) b);
-		p->num_of_free_blocks -= 1;
-		LIST_REMOVE(&freeBlockLists[idx], b);
-		return (void*) b;
-	}
-	if (LIST_SIZE(&freePagesList) > 0) {
-		//case two: a free page exists
-		struct PageInfoElement *p = LIST_FIRST(&freePagesList);
-		uint32 va = to_page_va(p);
-		get_page((void*) va);
-		p->block_size = nearestPof2;
-		p->num_of_free_blocks = (PAGE_SIZE / nearestPof2);
-		
-		//split page into blocks
-		for (uint32 i = va; i < va + PAGE_SIZE; i += nearestPof2) {
-			struct BlockElement *blockva = (struct BlockElement*) i;
-			LIST_INSERT_TAIL(&freeBlockLists[idx], blockva);
-		}
-		
-		LIST_REMOVE(&freePagesList, p);
-		struct BlockElement *b = LIST_FIRST(&freeBlockLists[idx]);
-		p->num_of_free_blocks -= 1;
-		LIST_REMOVE(&freeBlockLists[idx], b);
-		return (void*) b;
-	}
-	//case three: allocate block from next list
-	int sz = LOG2_MAX_SIZE - LOG2_MIN_SIZE + 1;
-	for (int i = idx; i < sz; i++) {
-		if (LIST_SIZE(&freeBlockLists[i]) > 0) {
-			struct BlockElement *b = LIST_FIRST(&freeBlockLists[i]);
-			struct PageInfoElement *p = to_page_info((uint32) b);
-			p->num_of_free_blocks -= 1;
-			LIST_REMOVE(&freeBlockLists[i], b);
-			return (void*) b;
-		}
+	int pIdx;
+	struct PageInfoElement *p = page_to_alloc_from(idx, &pIdx);
+	if (p != NULL)
+	{
+		void *va;
+		alloc_blocks_from_page(p, pIdx, size, 1, &va);
+		return va;
 	}
 
-	//found nothing
+	//found nothing (in the kernel, callers that can sleep use kmalloc_wait() to block till a block is freed)
+	dynAllocStats.num_of_failed_allocs++;
 	return NULL;
 
     //Comment the following line
@@ -176,6 +286,56 @@ void *alloc_block(uint32 size)
 //===========================
 // [4] FREE BLOCK:
 //===========================
+//Give back "n" blocks that all belong to the given page: the size class and the
+//page list are looked up once, then the page is either released (if it becomes empty)
+//or moved (once) to the list of its new fullness
+static void free_blocks_in_page(struct PageInfoElement *p, void* blocks[], uint32 n)
+{
+	unsigned int blkSz = p->block_size;
+	if (blkSz == 0)
+		return;
+	int idx = get_size_class(blkSz);
+
+	struct PageInfoElement_List *oldList = page_list_of(p, idx);
+	for (uint32 i = 0; i < n; i++)
+	{
+		struct BlockElement *b = (struct BlockElement*)blocks[i];
+		b->next = p->free_blocks;
+		p->free_blocks = b;
+	}
+	p->num_of_free_blocks += n;
+
+	dynAllocStats.num_of_frees[idx] += n;
+	dynAllocStats.num_of_used_blocks[idx] -= n;
+
+	unsigned int totBlks = PAGE_SIZE / blkSz;
+	if (p->num_of_free_blocks == totBlks)
+	{
+		//empty page: all its free blocks are in its own list, so just drop it
+		//and give the page back to freePagesList (i.e. the empty pages of all sizes)
+		LIST_REMOVE(oldList, p);
+		p->free_blocks = NULL;
+		p->block_size = 0;
+		p->num_of_free_blocks = 0;
+		p->num_of_carved_blocks = 0;
+		LIST_INSERT_TAIL(&freePagesList, p);
+
+		dynAllocStats.num_of_pages[idx]--;
+		dynAllocStats.num_of_pages_in_use--;
+
+		return_page((void*)to_page_va(p));
+	}
+	else
+	{
+		struct PageInfoElement_List *newList = page_list_of(p, idx);
+		if (newList != oldList)
+		{
+			LIST_REMOVE(oldList, p);
+			LIST_INSERT_HEAD(newList, p);
+		}
+	}
+}
+
 void free_block(void *va)
 {
 	//==================================================================================
@@ -191,43 +351,60 @@ void free_block(void *va)
 	//Your code is here
 	if(va==NULL)
 		return;
-	unsigned int blkSz = get_block_size(va);
-	unsigned int nearestPof2 = 8;
-	int idx = 0;
-	if (blkSz == 0)
-		return;
-	while (nearestPof2 < blkSz)
+	free_blocks_in_page(to_page_info((uint32) va), &va, 1);
+	//Comment the following line
+	//panic("free_block() Not implemented yet");
+}
+
+//===========================
+// [5] BATCHED ALLOC/FREE:
+//===========================
+//Allocate "n" blocks of the given size into out[]. The size class is looked up once and each page
+//serves as many blocks as it can before its list is updated. Returns the number of allocated blocks
+//(less than "n" only if the allocator is exhausted)
+uint32 alloc_blocks(uint32 size, uint32 n, void* out[])
+{
+	assert(size <= DYN_ALLOC_MAX_BLOCK_SIZE);
+	if (size == 0)
+		return 0;
+
+	int idx = get_size_class(size);
+	uint32 cnt = 0;
+	while (cnt < n)
 	{
-		nearestPof2 *= 2;
-		idx++;
+		int pIdx;
+		struct PageInfoElement *p = page_to_alloc_from(idx, &pIdx);
+		if (p == NULL)
+		{
+			dynAllocStats.num_of_failed_allocs++;
+			break;
+		}
+		cnt += alloc_blocks_from_page(p, pIdx, size, n - cnt, &out[cnt]);
 	}
+	return cnt;
+}
 
-	int nowPage = ((unsigned int) va - dynAllocStart) / PAGE_SIZE;
-	struct BlockElement *b = (struct BlockElement*)va;
-	LIST_INSERT_HEAD(&freeBlockLists[idx] , b);
-    pageBlockInfoArr[nowPage].num_of_free_blocks += 1;
+//Free the given "n" blocks (NULLs are skipped). Consecutive blocks of the same page are given back together
+void free_blocks(void* ptrs[], uint32 n)
+{
+	uint32 i = 0;
+	while (i < n)
+	{
+		if (ptrs[i] == NULL)
+		{
+			i++;
+			continue;
+		}
+		assert((uint32)ptrs[i] >= dynAllocStart && (uint32)ptrs[i] < dynAllocEnd);
+		struct PageInfoElement *p = to_page_info((uint32) ptrs[i]);
 
-    unsigned int totBlks = PAGE_SIZE / blkSz;
-    if(pageBlockInfoArr[nowPage].num_of_free_blocks == totBlks)
-    {
-    	struct BlockElement *cur = LIST_FIRST(&freeBlockLists[idx]);
-    	while(cur != NULL)
-    	{
-        	struct BlockElement *nxt = LIST_NEXT(cur);
-        	if (((unsigned int)cur - dynAllocStart) / PAGE_SIZE == nowPage)
-			{
-				LIST_REMOVE(&freeBlockLists[idx], cur);
-			}
-        	cur = nxt;
-    	}
-    LIST_INSERT_TAIL(&freePagesList, &pageBlockInfoArr[nowPage]);
-    pageBlockInfoArr[nowPage].block_size = 0;
-    pageBlockInfoArr[nowPage].num_of_free_blocks = 0;
+		uint32 j = i + 1;
+		while (j < n && ptrs[j] != NULL && to_page_info((uint32) ptrs[j]) == p)
+			j++;
 
-    return_page((void*)to_page_va(&pageBlockInfoArr[nowPage]));
-    }
-	//Comment the following line
-	//panic("free_block() Not implemented yet");
+		free_blocks_in_page(p, &ptrs[i], j - i);
+		i = j;
+	}
 }
 
 //==================================================================================//
@@ -248,21 +425,153 @@ void *realloc_block(void* va, uint32 new_size)
 		return NULL;
 	}
 
+	//too large for any block: the DA can't hold it (the caller allocates it elsewhere), the block is kept
+	if (new_size > DYN_ALLOC_MAX_BLOCK_SIZE)
+		return NULL;
+
+	//same size class: the current block already fits, so keep it in-place
+	//(counted as an alloc of new_size + a free of the old one, as if it was moved)
+	uint32 oldSize = get_block_size(va);
+	int idx = get_size_class(oldSize);
+	if (get_size_class(new_size) == idx)
+	{
+		dynAllocStats.num_of_allocs[idx]++;
+		dynAllocStats.num_of_frees[idx]++;
+		dynAllocStats.wasted_bytes[idx] += oldSize - new_size;
+		return va;
+	}
+
+	//else, move it to a block of the new class (copy the smaller of the two sizes)
 	void* newVAdress = alloc_block(new_size);
 
 	if(newVAdress!=NULL){
-		void* source = va;
-		void* dest = newVAdress;
-		uint32 sSize = (uint32)get_block_size(va);
-		uint32 nSize = (uint32)new_size;
-		int dSize;
-		if(sSize < nSize) dSize = sSize;
-		else dSize = nSize;
-		memmove(source,dest,dSize);
+		uint32 copySize = (oldSize < new_size) ? oldSize : new_size;
+		memmove(newVAdress, va, copySize);
 		free_block(va);
 	}
 
 	return newVAdress;
 	//Comment the following line
 	//panic("realloc_block() Not implemented yet");
-}
\ No newline at end of file
+}
+
+//==================================================================================//
+//================================= STATISTICS =====================================//
+//==================================================================================//
+
+void get_dynalloc_stats(struct DynAllocStats* stats)
+{
+	*stats = dynAllocStats;
+}
+
+void print_dynalloc_stats(char* title, struct DynAllocStats* stats)
+{
+	cprintf("%s - dynamic allocator statistics:\n", title);
+	cprintf("  size   allocs    frees     used    pages  unused(B)  wasted(B)\n");
+	for (int i = 0; i < DYN_ALLOC_NUM_OF_SIZES; ++i)
+	{
+		uint32 blkSize = dynAllocBlockSizes[i];
+		if (stats->num_of_allocs[i] == 0 && stats->num_of_pages[i] == 0)
+			continue;
+		//unused = free blocks + tail of the pages currently held by this size
+		uint32 unusedBytes = stats->num_of_pages[i] * PAGE_SIZE - stats->num_of_used_blocks[i] * blkSize;
+		cprintf("  %4d %8d %8d %8d %8d %10d %10d\n", blkSize, stats->num_of_allocs[i], stats->num_of_frees[i],
+				stats->num_of_used_blocks[i], stats->num_of_pages[i], unusedBytes, stats->wasted_bytes[i]);
+	}
+	cprintf("  pages in use = %d (peak = %d), failed allocs = %d\n",
+			stats->num_of_pages_in_use, stats->peak_num_of_pages_in_use, stats->num_of_failed_allocs);
+}
+
+//==================================================================================//
+//============================== INTEGRITY CHECK ===================================//
+//==================================================================================//
+
+//Check one used page of size class "idx" found in the given list: its block size, its list
+//(fullness), its count of free blocks and that each of its free blocks is a valid block of it
+static int check_used_page(struct PageInfoElement *p, int idx, struct PageInfoElement_List *list)
+{
+	int errors = 0;
+	uint32 pageVA = to_page_va(p);
+	if (p->block_size != dynAllocBlockSizes[idx])
+	{
+		cprintf("DA: page %x has block size %d in the lists of size %d\n", pageVA, p->block_size, dynAllocBlockSizes[idx]);
+		return 1;
+	}
+	if (page_list_of(p, idx) != list)
+	{
+		cprintf("DA: page %x (%d free blocks) is in the wrong list of its size\n", pageVA, p->num_of_free_blocks);
+		errors++;
+	}
+	uint32 totBlks = PAGE_SIZE / p->block_size;
+	if (p->num_of_carved_blocks > totBlks)
+	{
+		cprintf("DA: page %x has %d carved blocks (> %d)\n", pageVA, p->num_of_carved_blocks, totBlks);
+		return errors + 1;
+	}
+	//each freed block must be a carved block of this page (at most totBlks of them, so a cycle is caught too)
+	uint32 numOfListed = 0;
+	for (struct BlockElement *b = p->free_blocks; b != NULL; b = b->next)
+	{
+		uint32 offset = (uint32)b - pageVA;
+		if ((uint32)b < pageVA || offset >= p->num_of_carved_blocks * p->block_size || offset % p->block_size != 0
+			|| ++numOfListed > totBlks)
+		{
+			cprintf("DA: page %x has an invalid free block %x\n", pageVA, b);
+			return errors + 1;
+		}
+	}
+	uint32 numOfFree = numOfListed + (totBlks - p->num_of_carved_blocks);
+	if (numOfFree != p->num_of_free_blocks)
+	{
+		cprintf("DA: page %x has %d free blocks but num_of_free_blocks = %d\n", pageVA, numOfFree, p->num_of_free_blocks);
+		errors++;
+	}
+	return errors;
+}
+
+//Verify the page lists & the free blocks of each used page. Returns the number of errors found
+int check_dynalloc_integrity()
+{
+	int errors = 0;
+	uint32 numOfPages = 0, numOfUsedPages = 0;
+	struct PageInfoElement *p;
+
+	LIST_FOREACH(p, &freePagesList)
+	{
+		if (p->block_size != 0 || p->num_of_free_blocks != 0)
+		{
+			cprintf("DA: page %x in the free pages list is still used (block size %d)\n", to_page_va(p), p->block_size);
+			errors++;
+		}
+		numOfPages++;
+	}
+	for (int idx = 0; idx < DYN_ALLOC_NUM_OF_SIZES; ++idx)
+	{
+		for (int bin = 0; bin < DYN_ALLOC_FULLNESS_BINS; ++bin)
+		{
+			LIST_FOREACH(p, &partialPagesLists[idx][bin])
+			{
+				errors += check_used_page(p, idx, &partialPagesLists[idx][bin]);
+				numOfUsedPages++;
+			}
+		}
+		LIST_FOREACH(p, &fullPagesLists[idx])
+		{
+			errors += check_used_page(p, idx, &fullPagesLists[idx]);
+			numOfUsedPages++;
+		}
+	}
+	numOfPages += numOfUsedPages;
+
+	if (numOfPages != (dynAllocEnd - dynAllocStart) / PAGE_SIZE)
+	{
+		cprintf("DA: the lists have %d pages out of %d (pages are lost or linked twice)\n", numOfPages, (dynAllocEnd - dynAllocStart) / PAGE_SIZE);
+		errors++;
+	}
+	if (numOfUsedPages != dynAllocStats.num_of_pages_in_use)
+	{
+		cprintf("DA: %d pages are used but the statistics say %d\n", numOfUsedPages, dynAllocStats.num_of_pages_in_use);
+		errors++;
+	}
+	return errors;
+}
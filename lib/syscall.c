@@ -272,6 +272,12 @@ int sys_get_optimal_num_faults()
 	return syscall(SYS_get_optimal_num_faults, 0, 0, 0, 0, 0);
 }
 
+void sys_get_kheap_da_stats(struct DynAllocStats* stats)
+{
+	syscall(SYS_get_kheap_da_stats, (uint32)stats, 0, 0, 0, 0);
+	return;
+}
+
 void sys_free_user_mem(uint32 virtual_address, uint32 size)
 {
 	syscall(SYS_free_user_mem, virtual_address, size, 0, 0, 0);
@@ -162,3 +162,20 @@ void sfree(void* virtual_address)
 //==================================================================================//
 //========================== MODIFICATION FUNCTIONS ================================//
 //==================================================================================//
+
+//==================================================================================//
+//================================ STATISTICS ======================================//
+//==================================================================================//
+//Print the statistics of the block allocator of this program's user heap (its own copy of the DA)
+//and of the kernel heap (copied from the kernel using sys_get_kheap_da_stats())
+void print_heap_da_stats()
+{
+	uheap_init();
+	struct DynAllocStats stats;
+
+	get_dynalloc_stats(&stats);
+	print_dynalloc_stats("USER heap", &stats);
+
+	sys_get_kheap_da_stats(&stats);
+	print_dynalloc_stats("KERNEL heap", &stats);
+}
@@ -0,0 +1,63 @@
+// Test kmalloc_wait(): a process that asks for a block while the kernel block allocator is full
+// is blocked till another process frees a block, then resumes with a block
+// Master program: fill the kernel block allocator, run the slave, free a block once it's blocked
+#include <inc/lib.h>
+
+void
+_main(void)
+{
+	//Create the slave before filling the block allocator (its creation allocates blocks)
+	int id = sys_create_env("tstKMallocWaitSlave", (myEnv->page_WS_max_size),(myEnv->SecondListSize), (myEnv->percentage_of_WS_pages_to_be_removed));
+	if (id == E_ENV_CREATION_ERROR)
+		panic("%~test kmalloc_wait failed! can't create the slave process");
+
+	rsttst();
+	int isFull = 0;
+	sys_utilities("__KHeapFillDA__", (uint32)(&isFull));
+	if (!isFull)
+	{
+		sys_utilities("__KHeapReleaseDA__", 0);
+		panic("%~test kmalloc_wait can't run! not enough free frames to fill the kernel block allocator (run it with more RAM)");
+	}
+	sys_run_env(id);
+
+	//Wait until the slave is blocked inside kmalloc_wait()
+	int numOfWaiters = 0;
+	sys_utilities("__GetKHeapDAWaitersCnt__", (uint32)(&numOfWaiters));
+	int cnt = 0;
+	while (numOfWaiters != 1)
+	{
+		env_sleep(1000);
+		if (cnt == 5)
+		{
+			sys_utilities("__KHeapReleaseDA__", 0);
+			panic("%~test kmalloc_wait failed! the slave is not blocked. # blocked processes = %d, # slaves finished = %d", numOfWaiters, gettst());
+		}
+		sys_utilities("__GetKHeapDAWaitersCnt__", (uint32)(&numOfWaiters));
+		cnt++ ;
+	}
+	if (gettst() != 0)
+	{
+		sys_utilities("__KHeapReleaseDA__", 0);
+		panic("%~test kmalloc_wait failed! the slave finished while the block allocator is full");
+	}
+
+	//Free one block: the slave shall be woken up and get it
+	sys_utilities("__KFreeOneDABlock__", 0);
+	cnt = 0;
+	while (gettst() != 1)
+	{
+		env_sleep(1000);
+		if (cnt == 5)
+		{
+			sys_utilities("__KHeapReleaseDA__", 0);
+			panic("%~test kmalloc_wait failed! the slave is not resumed after freeing a block");
+		}
+		cnt++ ;
+	}
+
+	sys_utilities("__KHeapReleaseDA__", 0);
+	cprintf("%~\n\nCongratulations!! Test of kmalloc_wait() completed successfully!!\n\n");
+
+	return;
+}
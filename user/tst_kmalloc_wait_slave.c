@@ -0,0 +1,17 @@
+// Test kmalloc_wait()
+// Slave program: ask for a block while the kernel block allocator is full, increment test once it's got
+#include <inc/lib.h>
+
+void
+_main(void)
+{
+	int success = 0;
+	sys_utilities("__KMallocWait__", (uint32)(&success));
+	if (!success)
+		panic("%~test kmalloc_wait failed! kmalloc_wait() returned NULL");
+
+	//indicates resumed with a block
+	inctst();
+
+	return;
+}